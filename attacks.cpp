@@ -0,0 +1,169 @@
+#include <array>
+#include <bit>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "attacks.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+std::array<Magic, 64> rook_magics{};
+std::array<Magic, 64> bishop_magics{};
+bool use_pext{};
+std::array<std::array<U64, 64>, 64> squares_between{};
+std::array<std::array<U64, 64>, 64> line_through{};
+
+// Attack tables shared by all squares ("fancy" magics). Each square gets 2^(number of bits in its mask) entries.
+static std::array<U64, 0x19000> rook_table{};
+static std::array<U64, 0x1480> bishop_table{};
+
+// Time it took to build the tables.
+static double init_milliseconds{};
+
+static constexpr U64 A_FILE{ 0x0101010101010101ULL };
+static constexpr U64 H_FILE{ 0x8080808080808080ULL };
+static constexpr U64 RANK_1{ 0xFFULL };
+static constexpr U64 RANK_8{ 0xFF00000000000000ULL };
+
+// Rank and file steps for the rays of the sliding pieces.
+static constexpr std::array<std::array<int, 2>, 4> ROOK_DIRECTIONS{ { {1, 0}, {-1, 0}, {0, 1}, {0, -1} } };
+static constexpr std::array<std::array<int, 2>, 4> BISHOP_DIRECTIONS{ { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} } };
+
+// Seeds of the random generator for each rank. They were picked to find the magics of that rank quickly.
+static constexpr std::array<U64, 8> MAGIC_SEEDS{ 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+
+// This function walks the rays from the square in the given directions until the edge of the board or the first
+// occupied square (which is included, it can be a capture). It's only used to fill the tables.
+static U64 sliding_attacks(int square, U64 occupied, const std::array<std::array<int, 2>, 4>& directions) {
+	U64 attacks{};
+	for (const std::array<int, 2>& direction : directions) {
+		int rank = square / 8 + direction[0];
+		int file = square % 8 + direction[1];
+		while (rank >= 0 && rank < 8 && file >= 0 && file < 8) {
+			U64 target = 1ULL << (rank * 8 + file);
+			attacks |= target;
+			if (occupied & target) break;
+			rank += direction[0];
+			file += direction[1];
+		}
+	}
+	return attacks;
+}
+
+// Xorshift64* pseudo-random generator for the magic candidates.
+static U64 random_u64(U64& state) {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ULL;
+}
+
+// This function checks if the CPU supports BMI2 (and therefore PEXT).
+static bool cpu_has_bmi2() {
+#if defined(_MSC_VER) && defined(_M_X64)
+	int registers[4]{};
+	__cpuidex(registers, 7, 0);
+	return (registers[1] >> 8) & 1;
+#elif defined(PEXT_AVAILABLE)
+	return __builtin_cpu_supports("bmi2");
+#else
+	return false;
+#endif
+}
+
+// This function fills the magic entries and the attack table for one piece type.
+static void init_magics(std::array<Magic, 64>& magics, U64* table, const std::array<std::array<int, 2>, 4>& directions) {
+	std::array<U64, 4096> occupancies;
+	std::array<U64, 4096> reference;
+	// Attempt number when each table entry was last written. It saves clearing the table after every failed magic.
+	std::array<int, 4096> epoch{};
+	int attempt{};
+	U64* next_attacks = table;
+
+	for (int square = 0; square < 64; ++square) {
+		Magic& magic = magics[square];
+		// Pieces on the board edge never block anything, so they are excluded from the mask (unless the piece is on that
+		// edge itself).
+		U64 edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (square / 8 * 8))) | ((A_FILE | H_FILE) & ~(A_FILE << (square % 8)));
+		magic.mask = sliding_attacks(square, 0, directions) & ~edges;
+		magic.shift = static_cast<unsigned>(64 - std::popcount(magic.mask));
+		magic.attacks = next_attacks;
+
+		// Go through all subsets of the mask (Carry-Rippler trick) and save the attacks for each of them.
+		int size{};
+		U64 occupied{};
+		do {
+			occupancies[size] = occupied;
+			reference[size] = sliding_attacks(square, occupied, directions);
+			if (use_pext)
+				magic.attacks[magic.index(occupied)] = reference[size];
+			++size;
+			occupied = (occupied - magic.mask) & magic.mask;
+		} while (occupied);
+		next_attacks += size;
+
+		// PEXT maps every subset to its own index, so there is nothing to search for.
+		if (use_pext) continue;
+
+		// Try random sparse numbers until one maps every subset to an entry without a collision that changes the attacks.
+		U64 random_state = MAGIC_SEEDS[square / 8];
+		for (int i = 0; i < size;) {
+			for (magic.magic = 0; std::popcount((magic.magic * magic.mask) >> 56) < 6;)
+				magic.magic = random_u64(random_state) & random_u64(random_state) & random_u64(random_state);
+			for (++attempt, i = 0; i < size; ++i) {
+				unsigned index = magic.index(occupancies[i]);
+				if (epoch[index] < attempt) {
+					epoch[index] = attempt;
+					magic.attacks[index] = reference[i];
+				}
+				else if (magic.attacks[index] != reference[i])
+					break;
+			}
+		}
+	}
+}
+
+// This function fills the tables of the squares between and the lines through two aligned squares from the sliding
+// attacks on an empty board.
+static void init_lines() {
+	for (int first = 0; first < 64; ++first) {
+		for (int second = 0; second < 64; ++second) {
+			U64 first_bit = 1ULL << first;
+			U64 second_bit = 1ULL << second;
+			std::size_t i = static_cast<std::size_t>(first);
+			std::size_t j = static_cast<std::size_t>(second);
+			if (bishop_attacks(first, 0) & second_bit) {
+				squares_between[i][j] = bishop_attacks(first, second_bit) & bishop_attacks(second, first_bit);
+				line_through[i][j] = (bishop_attacks(first, 0) & bishop_attacks(second, 0)) | first_bit | second_bit;
+			}
+			else if (rook_attacks(first, 0) & second_bit) {
+				squares_between[i][j] = rook_attacks(first, second_bit) & rook_attacks(second, first_bit);
+				line_through[i][j] = (rook_attacks(first, 0) & rook_attacks(second, 0)) | first_bit | second_bit;
+			}
+		}
+	}
+}
+
+// This function fills the sliding attack tables. It has to be called once at startup, before any move generation.
+// PEXT indexing is used if the CPU supports BMI2 and allow_pext is set.
+void init_attack_tables(bool allow_pext) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	use_pext = allow_pext && cpu_has_bmi2();
+	init_magics(rook_magics, rook_table.data(), ROOK_DIRECTIONS);
+	init_magics(bishop_magics, bishop_table.data(), BISHOP_DIRECTIONS);
+	init_lines();
+	init_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// This function returns the size of the attack tables, the time it took to build them and the indexing method.
+std::string attack_tables_info() {
+	std::size_t table_bytes = sizeof(rook_table) + sizeof(bishop_table) + sizeof(rook_magics) + sizeof(bishop_magics)
+		+ sizeof(squares_between) + sizeof(line_through);
+	std::ostringstream info;
+	info << "Attack tables: " << table_bytes / 1024 << " KB, " << (use_pext ? "PEXT" : "magic") << " indexing, built in "
+		<< std::fixed << std::setprecision(2) << init_milliseconds << " ms";
+	return info.str();
+}
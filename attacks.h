@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// PEXT can only be used on x86-64.
+#if (defined(_MSC_VER) && defined(_M_X64)) || ((defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__))
+#include <immintrin.h>
+#define PEXT_AVAILABLE
+#endif
+
+typedef uint64_t U64;
+
+static constexpr U64 NOT_A_FILE{ 0xFEFEFEFEFEFEFEFEULL };
+static constexpr U64 NOT_H_FILE{ 0x7F7F7F7F7F7F7F7FULL };
+static constexpr U64 NOT_A_B_FILES{ 0xFCFCFCFCFCFCFCFCULL };
+static constexpr U64 NOT_G_H_FILES{ 0x3F3F3F3F3F3F3F3FULL };
+
+// Set-wise pawn shifts for the whole pawn bitboard at once. Captures to the west (a file side) can't land on the
+// h file and captures to the east can't land on the a file, otherwise they wrapped around the board edge.
+constexpr U64 pawn_pushes(U64 pawns, bool white) { return white ? pawns << 8 : pawns >> 8; }
+constexpr U64 pawn_west_captures(U64 pawns, bool white) { return (white ? pawns << 7 : pawns >> 9) & NOT_H_FILE; }
+constexpr U64 pawn_east_captures(U64 pawns, bool white) { return (white ? pawns << 9 : pawns >> 7) & NOT_A_FILE; }
+
+// This function returns all squares attacked by a knight from the square. Shifts that wrap around the board edge are
+// masked out by the files on the opposite side.
+constexpr U64 knight_attacks_from(int square) {
+	U64 bitboard = 1ULL << square;
+	return ((bitboard << 17) & NOT_A_FILE) | ((bitboard << 15) & NOT_H_FILE) | ((bitboard << 10) & NOT_A_B_FILES)
+		| ((bitboard << 6) & NOT_G_H_FILES) | ((bitboard >> 17) & NOT_H_FILE) | ((bitboard >> 15) & NOT_A_FILE)
+		| ((bitboard >> 10) & NOT_G_H_FILES) | ((bitboard >> 6) & NOT_A_B_FILES);
+}
+
+// This function returns all squares attacked by a king from the square.
+constexpr U64 king_attacks_from(int square) {
+	U64 bitboard = 1ULL << square;
+	U64 sides = ((bitboard << 1) & NOT_A_FILE) | ((bitboard >> 1) & NOT_H_FILE);
+	bitboard |= sides;
+	return sides | (bitboard << 8) | (bitboard >> 8);
+}
+
+// Attack tables for the knight and the king, built at compile time.
+inline constexpr std::array<U64, 64> KNIGHT_ATTACKS = [] {
+	std::array<U64, 64> attacks{};
+	for (int square = 0; square < 64; ++square)
+		attacks[static_cast<std::size_t>(square)] = knight_attacks_from(square);
+	return attacks;
+}();
+
+inline constexpr std::array<U64, 64> KING_ATTACKS = [] {
+	std::array<U64, 64> attacks{};
+	for (int square = 0; square < 64; ++square)
+		attacks[static_cast<std::size_t>(square)] = king_attacks_from(square);
+	return attacks;
+}();
+
+// Pawn attack tables, indexed by color first (0 - black, 1 - white).
+inline constexpr std::array<std::array<U64, 64>, 2> PAWN_ATTACKS = [] {
+	std::array<std::array<U64, 64>, 2> attacks{};
+	for (int square = 0; square < 64; ++square) {
+		U64 bitboard = 1ULL << square;
+		attacks[0][static_cast<std::size_t>(square)] = pawn_west_captures(bitboard, false) | pawn_east_captures(bitboard, false);
+		attacks[1][static_cast<std::size_t>(square)] = pawn_west_captures(bitboard, true) | pawn_east_captures(bitboard, true);
+	}
+	return attacks;
+}();
+
+// PEXT (parallel bits extract) from BMI2. GCC and Clang only compile it inside functions built for BMI2, so this
+// function is built for BMI2 even when the rest of the engine isn't. It's only called when the CPU supports it.
+#if defined(PEXT_AVAILABLE)
+#if defined(_MSC_VER)
+inline U64 pext(U64 bitboard, U64 mask) { return _pext_u64(bitboard, mask); }
+#else
+__attribute__((target("bmi2"))) inline U64 pext(U64 bitboard, U64 mask) { return _pext_u64(bitboard, mask); }
+#endif
+#endif
+
+// Magic bitboard entry for one square. The relevant occupancy (blockers inside the mask) is hashed into the index of
+// the square's part of the attack table, either by the magic multiplication or by PEXT.
+struct Magic {
+	U64 mask;
+	U64 magic;
+	U64* attacks;
+	unsigned shift;
+
+	// This function returns the index of the occupancy in the square's attack table.
+	unsigned index(U64 occupied) const;
+};
+
+// Magic entries for rooks and bishops.
+extern std::array<Magic, 64> rook_magics;
+extern std::array<Magic, 64> bishop_magics;
+
+// True if the tables are indexed by PEXT instead of the magic multiplication (chosen at startup).
+extern bool use_pext;
+
+// This function returns the index of the occupancy in the square's attack table.
+inline unsigned Magic::index(U64 occupied) const {
+#if defined(PEXT_AVAILABLE)
+	if (use_pext)
+		return static_cast<unsigned>(pext(occupied, mask));
+#endif
+	return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+}
+
+// This function returns all squares attacked by a bishop from the square.
+inline U64 bishop_attacks(int square, U64 occupied) {
+	const Magic& magic = bishop_magics[static_cast<std::size_t>(square)];
+	return magic.attacks[magic.index(occupied)];
+}
+
+// This function returns all squares attacked by a rook from the square.
+inline U64 rook_attacks(int square, U64 occupied) {
+	const Magic& magic = rook_magics[static_cast<std::size_t>(square)];
+	return magic.attacks[magic.index(occupied)];
+}
+
+// This function returns all squares attacked by a queen from the square.
+inline U64 queen_attacks(int square, U64 occupied) {
+	return bishop_attacks(square, occupied) | rook_attacks(square, occupied);
+}
+
+// Squares strictly between two squares on the same rank, file or diagonal, and the whole line through them (both
+// empty if the squares aren't aligned). Filled by init_attack_tables.
+extern std::array<std::array<U64, 64>, 64> squares_between;
+extern std::array<std::array<U64, 64>, 64> line_through;
+
+// This function fills the sliding attack tables. It has to be called once at startup, before any move generation.
+// PEXT indexing is used if the CPU supports BMI2 and allow_pext is set.
+void init_attack_tables(bool allow_pext = true);
+
+// This function returns the size of the attack tables, the time it took to build them and the indexing method.
+std::string attack_tables_info();
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "batch.h"
+#include "game_class.h"
+#include "mapped_file.h"
+#include "nnue.h"
+#include "perft.h"
+#include "search.h"
+#include "tt.h"
+
+// Operations the batch mode applies to every position.
+enum BatchOperation { BATCH_PERFT, BATCH_SEARCH, BATCH_EVAL, BATCH_MOVES };
+
+// The file is split into blocks of whole lines that the workers take one at a time. There are about
+// BLOCKS_PER_THREAD blocks per worker (so a slow block doesn't leave the others idle at the end), within these sizes.
+static constexpr std::size_t MIN_BLOCK_BYTES{ 4096 };
+static constexpr std::size_t MAX_BLOCK_BYTES{ 1 << 20 };
+static constexpr std::size_t BLOCKS_PER_THREAD{ 64 };
+
+// With ordered output, finished blocks wait until all the blocks before them are written. A worker doesn't start a
+// block more than this many blocks (per worker) ahead of the next one to be written, so the waiting output stays small.
+static constexpr std::size_t MAX_PENDING_BLOCKS_PER_THREAD{ 4 };
+
+// Batch mode run: the mapped input, the blocks the workers take and the output waiting to be written.
+class BatchRunner {
+	std::string_view m_input;
+	BatchOperation m_operation;
+	int m_depth;
+	bool m_ordered;
+	std::size_t m_block_bytes;
+	std::size_t m_block_count;
+	std::size_t m_max_pending_blocks;
+
+	std::atomic<std::size_t> m_next_block{};
+	std::atomic<std::uint64_t> m_positions{};
+	std::atomic<std::uint64_t> m_errors{};
+
+	std::mutex m_output_mutex{};
+	std::condition_variable m_output_condition{};
+	// Finished blocks waiting for the blocks before them (ordered output only).
+	std::map<std::size_t, std::string> m_finished_blocks{};
+	std::size_t m_next_output_block{};
+
+	// This function applies the operation to the position of the line and appends the line and the result to the
+	// output.
+	void process_line(std::string_view line, GameData& game_data, std::string& output) {
+		output.append(line);
+		output += " ; ";
+		if (const char* error = game_data.set_fen(fen_of_line(line))) {
+			output += "error ";
+			output += error;
+			output += '\n';
+			m_errors.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		game_data.reset_undo_stack();
+		switch (m_operation) {
+		case BATCH_PERFT:
+			output += "perft " + std::to_string(m_depth) + ' ' + std::to_string(perft(game_data, m_depth, true));
+			break;
+		case BATCH_SEARCH: {
+			SearchLimits limits{};
+			limits.depth = m_depth;
+			SearchResult result = search(game_data, limits, false);
+			output += "search " + std::to_string(result.depth) + " bestmove "
+				+ (result.best_move == NO_MOVE ? std::string{ "0000" } : move_to_string(result.best_move)) + " score "
+				+ score_to_string(result.score);
+			break;
+		}
+		case BATCH_EVAL:
+			output += "eval " + std::to_string(static_evaluation(game_data));
+			break;
+		case BATCH_MOVES: {
+			MoveList move_list;
+			game_data.generate_legal_moves(move_list);
+			output += "moves " + std::to_string(move_list.size());
+			break;
+		}
+		}
+		output += '\n';
+		m_positions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// This function processes the lines that start in the block. Empty lines and comments (starting with '#') are
+	// skipped.
+	void process_block(std::size_t block, GameData& game_data, std::string& output) {
+		std::size_t begin = block * m_block_bytes;
+		std::size_t end = std::min(begin + m_block_bytes, m_input.size());
+		// The line crossing the start of the block belongs to the previous block.
+		std::size_t line_start = begin;
+		if (begin) {
+			std::size_t line_feed = m_input.find('\n', begin - 1);
+			line_start = line_feed == std::string_view::npos ? m_input.size() : line_feed + 1;
+		}
+		while (line_start < end) {
+			std::size_t line_end = std::min(m_input.find('\n', line_start), m_input.size());
+			std::string_view line = m_input.substr(line_start, line_end - line_start);
+			if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+			if (!line.empty() && line[0] != '#')
+				process_line(line, game_data, output);
+			line_start = line_end + 1;
+		}
+	}
+
+	// This function writes the output of the finished block. With ordered output it's kept until the blocks before it
+	// are written.
+	void write_block(std::size_t block, std::string&& output) {
+		std::lock_guard<std::mutex> lock(m_output_mutex);
+		if (!m_ordered) {
+			std::cout.write(output.data(), static_cast<std::streamsize>(output.size()));
+			return;
+		}
+		m_finished_blocks.emplace(block, std::move(output));
+		while (!m_finished_blocks.empty() && m_finished_blocks.begin()->first == m_next_output_block) {
+			const std::string& block_output = m_finished_blocks.begin()->second;
+			std::cout.write(block_output.data(), static_cast<std::streamsize>(block_output.size()));
+			m_finished_blocks.erase(m_finished_blocks.begin());
+			++m_next_output_block;
+		}
+		m_output_condition.notify_all();
+	}
+
+	// This function takes blocks until there are none left. Every worker keeps its own game object for the positions.
+	void worker() {
+		std::unique_ptr<GameData> game_data = std::make_unique<GameData>(GameData::create_game_object_start_pos());
+		while (true) {
+			std::size_t block = m_next_block.fetch_add(1);
+			if (block >= m_block_count) return;
+			if (m_ordered) {
+				std::unique_lock<std::mutex> lock(m_output_mutex);
+				m_output_condition.wait(lock, [this, block] { return block < m_next_output_block + m_max_pending_blocks; });
+			}
+			std::string output{};
+			process_block(block, *game_data, output);
+			write_block(block, std::move(output));
+		}
+	}
+
+public:
+	BatchRunner(std::string_view input, BatchOperation operation, int depth, bool ordered, std::size_t thread_count)
+		: m_input{ input }
+		, m_operation{ operation }
+		, m_depth{ depth }
+		, m_ordered{ ordered }
+		, m_block_bytes{ std::clamp(input.size() / (thread_count * BLOCKS_PER_THREAD), MIN_BLOCK_BYTES, MAX_BLOCK_BYTES) }
+		, m_block_count{ (input.size() + m_block_bytes - 1) / m_block_bytes }
+		, m_max_pending_blocks{ thread_count * MAX_PENDING_BLOCKS_PER_THREAD }
+	{
+	}
+
+	// This function processes the whole input with the threads and reports the throughput on the error output.
+	void run(std::size_t thread_count) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<std::thread> workers{};
+		for (std::size_t i = 0; i < thread_count; ++i)
+			workers.emplace_back([this] { worker(); });
+		for (std::thread& worker_thread : workers)
+			worker_thread.join();
+		std::cout << std::flush;
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::uint64_t positions = m_positions.load();
+		std::cerr << "Positions: " << positions << ", invalid lines: " << m_errors.load() << ", threads: " << thread_count
+			<< ", time: " << std::fixed << std::setprecision(3) << seconds << " s, " << std::setprecision(0)
+			<< (seconds > 0 ? static_cast<double>(positions) / seconds : 0.0) << " positions per second" << '\n';
+		std::cerr.unsetf(std::ios::fixed);
+	}
+};
+
+// This function runs the batch command line mode: "batch <file> <operation> [depth] [options]". The operation (perft,
+// search, eval or moves) is applied to every FEN or EPD line of the file on all cores and the results are written to
+// the standard output. Returns the exit code of the program.
+int batch_command(const std::vector<std::string>& arguments) {
+	try {
+		if (arguments.size() < 2)
+			throw "missing file or operation.";
+		BatchOperation operation{};
+		int depth{};
+		std::size_t argument_index{ 2 };
+		if (arguments[1] == "perft" || arguments[1] == "search") {
+			operation = arguments[1] == "perft" ? BATCH_PERFT : BATCH_SEARCH;
+			if (arguments.size() < 3) throw "missing depth.";
+			depth = std::stoi(arguments[argument_index++]);
+			if (depth < 1 || depth >= MAX_PLY) throw "depth has to be between 1 and 127.";
+		}
+		else if (arguments[1] == "eval") operation = BATCH_EVAL;
+		else if (arguments[1] == "moves") operation = BATCH_MOVES;
+		else throw "unknown operation.";
+		std::size_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+		bool ordered{ true };
+		for (; argument_index < arguments.size(); ++argument_index) {
+			if (arguments[argument_index] == "--unordered") ordered = false;
+			else if (arguments[argument_index] == "--threads") {
+				if (argument_index + 1 == arguments.size()) throw "missing option value.";
+				int value = std::stoi(arguments[++argument_index]);
+				if (value < 1) throw "option value has to be at least 1.";
+				thread_count = static_cast<std::size_t>(value);
+			}
+			else throw "unknown option.";
+		}
+		MappedFile file{ arguments[0], true };
+		// The positions are searched in parallel, so every search uses one thread.
+		std::size_t search_threads = get_search_threads();
+		set_search_threads(1);
+		BatchRunner runner{ file.contents(), operation, depth, ordered, thread_count };
+		runner.run(thread_count);
+		set_search_threads(search_threads);
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << '\n';
+		std::cerr << "Usage: batch <file> perft <depth> | search <depth> | eval | moves [--threads n] [--unordered]" << '\n';
+		return 1;
+	}
+	catch (const std::exception&) {
+		std::cerr << "Error: depth and option values have to be numbers." << '\n';
+		return 1;
+	}
+	return 0;
+}
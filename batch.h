@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// This function runs the batch command line mode: "batch <file> <operation> [depth] [options]". The operation (perft,
+// search, eval or moves) is applied to every FEN or EPD line of the file on all cores and the results are written to
+// the standard output. Returns the exit code of the program.
+int batch_command(const std::vector<std::string>& arguments);
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "nnue.h"
+#include "packed_position.h"
+#include "perft.h"
+#include "search.h"
+#include "tt.h"
+
+// This function searches every reference position to the depth (with a cleared transposition table and move ordering
+// history, so the node counts are the same in every run) and reports the total node count and speed.
+static void search_benchmark(int depth) {
+	std::uint64_t total_nodes{};
+	double total_seconds{};
+	// The pawn hash table counters of the search thread are cumulative, the last search has the totals.
+	std::uint64_t pawn_table_probes{};
+	std::uint64_t pawn_table_hits{};
+	std::cout << "Position             Nodes  Best move   Score       Mnps" << '\n';
+	for (const PerftPosition& position : PERFT_POSITIONS) {
+		transposition_table.clear();
+		clear_search_history();
+		GameData game_data = GameData::create_game_object_from_fen(position.fen);
+		SearchLimits limits{};
+		limits.depth = depth;
+		SearchResult result = search(game_data, limits, false);
+		total_nodes += result.nodes;
+		total_seconds += result.seconds;
+		pawn_table_probes = result.pawn_table_probes;
+		pawn_table_hits = result.pawn_table_hits;
+		std::cout << std::left << std::setw(12) << position.name << std::right << std::setw(14) << result.nodes
+			<< std::setw(11) << move_to_string(result.best_move) << std::setw(12) << score_to_string(result.score)
+			<< std::fixed << std::setprecision(2) << std::setw(11) << static_cast<double>(result.nodes) / result.seconds / 1e6
+			<< '\n';
+	}
+	std::cout << "Nodes: " << total_nodes << ", time: " << std::setprecision(3) << total_seconds << " s, "
+		<< std::setprecision(2) << static_cast<double>(total_nodes) / total_seconds / 1e6 << " Mnps" << '\n';
+	if (pawn_table_probes)
+		std::cout << "Pawn hash table hits: " << 100.0 * static_cast<double>(pawn_table_hits)
+			/ static_cast<double>(pawn_table_probes) << "%" << '\n';
+	std::cout.unsetf(std::ios::fixed);
+}
+
+// This function measures the Lazy SMP time to depth: it searches all reference positions to the depth with 1, 2, 4 ...
+// max_threads threads (with a cleared transposition table and move ordering history each time) and prints the speedup
+// and the node counts of each thread.
+static void smp_benchmark(int depth, std::size_t max_threads) {
+	std::size_t original_thread_count = get_search_threads();
+	double single_thread_seconds{};
+	std::cout << "Threads    Time (s)   Speedup        Nodes       Mnps" << '\n';
+	for (std::size_t thread_count = 1;; thread_count = std::min(thread_count * 2, max_threads)) {
+		set_search_threads(thread_count);
+		double seconds{};
+		std::uint64_t nodes{};
+		std::vector<std::uint64_t> thread_nodes(thread_count);
+		for (const PerftPosition& position : PERFT_POSITIONS) {
+			transposition_table.clear();
+			clear_search_history();
+			SearchLimits limits{};
+			limits.depth = depth;
+			SearchResult result = search(GameData::create_game_object_from_fen(position.fen), limits, false);
+			seconds += result.seconds;
+			nodes += result.nodes;
+			for (std::size_t i = 0; i < thread_count; ++i)
+				thread_nodes[i] += result.thread_nodes[i];
+		}
+		if (thread_count == 1) single_thread_seconds = seconds;
+		std::cout << std::setw(7) << thread_count << std::fixed << std::setprecision(3) << std::setw(12) << seconds
+			<< std::setprecision(2) << std::setw(10) << single_thread_seconds / seconds << std::setw(13) << nodes
+			<< std::setw(11) << static_cast<double>(nodes) / seconds / 1e6 << '\n';
+		std::cout << "        Nodes per thread:";
+		for (std::uint64_t count : thread_nodes)
+			std::cout << ' ' << count;
+		std::cout << '\n';
+		if (thread_count == max_threads) break;
+	}
+	set_search_threads(original_thread_count);
+}
+
+// This function stores and probes random keys from several threads at once and checks every hit: the data of each
+// entry is derived from its key, so a torn or mixed up entry would be found. Returns true if no entry was corrupted.
+static bool tt_benchmark(std::size_t megabytes, std::size_t thread_count) {
+	constexpr std::uint64_t OPERATIONS_PER_THREAD{ 4000000 };
+	transposition_table.resize(megabytes);
+	std::cout << transposition_table.info() << '\n';
+	std::atomic<std::uint64_t> hits{};
+	std::atomic<std::uint64_t> corrupted{};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads{};
+	for (std::size_t thread = 0; thread < thread_count; ++thread) {
+		threads.emplace_back([&hits, &corrupted, thread] {
+			// All threads draw keys from the same sequence (offset per thread), so they write the same entries.
+			std::uint64_t state{ 0x9E3779B97F4A7C15ULL + thread * 1000 };
+			std::uint64_t thread_hits{};
+			std::uint64_t thread_corrupted{};
+			for (std::uint64_t i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+				state ^= state >> 12;
+				state ^= state << 25;
+				state ^= state >> 27;
+				U64 key = (state * 2685821657736338717ULL) % (1ULL << 22) * 0x9E3779B97F4A7C15ULL;
+				TTData data{};
+				if (transposition_table.probe(key, data)) {
+					++thread_hits;
+					if (data.move != static_cast<Move>(key >> 48) || data.score != static_cast<std::int16_t>(key >> 32)
+						|| data.depth != static_cast<std::int8_t>(key & 63))
+						++thread_corrupted;
+				}
+				else
+					transposition_table.store(key, static_cast<Move>(key >> 48), static_cast<std::int16_t>(key >> 32),
+						static_cast<int>(key & 63), BOUND_EXACT);
+			}
+			hits += thread_hits;
+			corrupted += thread_corrupted;
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::uint64_t operations = OPERATIONS_PER_THREAD * thread_count;
+	std::cout << "Threads: " << thread_count << ", operations: " << operations << ", hits: " << hits
+		<< ", corrupted entries: " << corrupted << ", hashfull: " << transposition_table.hashfull() << '\n';
+	std::cout << std::fixed << std::setprecision(2) << static_cast<double>(operations) / seconds / 1e6 << " M operations per second" << '\n';
+	transposition_table.resize(DEFAULT_HASH_MEGABYTES);
+	return corrupted == 0;
+}
+
+// This function parses the FENs of the reference positions repeatedly and reports the number of FENs per second.
+// Returns false if one of them didn't parse.
+static bool fen_benchmark(std::uint64_t repetitions) {
+	Position position{};
+	U64 key_sum{};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::uint64_t i = 0; i < repetitions; ++i) {
+		for (const PerftPosition& perft_position : PERFT_POSITIONS) {
+			if (const char* error = position.set_fen(perft_position.fen)) {
+				std::cerr << "Error: " << perft_position.name << ": " << error << '\n';
+				return false;
+			}
+			// Use the result, so the parsing isn't optimized away.
+			key_sum += position.get_key();
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::uint64_t fens = repetitions * PERFT_POSITIONS.size();
+	std::cout << "FENs: " << fens << ", time: " << std::fixed << std::setprecision(3) << seconds << " s, "
+		<< std::setprecision(2) << static_cast<double>(fens) / seconds / 1e6 << " million FENs per second (key sum "
+		<< std::hex << key_sum << std::dec << ")" << '\n';
+	std::cout.unsetf(std::ios::fixed);
+	return true;
+}
+
+// This function plays random games from the starting position (with a fixed seed, so every run gets the same games)
+// and returns all their positions.
+static std::vector<Position> random_game_positions(std::size_t game_count) {
+	static constexpr int MAX_GAME_PLIES{ 200 };
+	std::mt19937_64 generator{ 2024 };
+	std::vector<Position> positions{};
+	for (std::size_t game = 0; game < game_count; ++game) {
+		GameData game_data = GameData::create_game_object_start_pos();
+		for (int ply = 0; ply < MAX_GAME_PLIES; ++ply) {
+			positions.push_back(game_data);
+			MoveList move_list;
+			game_data.generate_legal_moves(move_list);
+			if (!move_list.size()) break;
+			game_data.make_move(move_list.moves[generator() % move_list.size()]);
+		}
+	}
+	return positions;
+}
+
+// This function compares reading packed positions (whole and chained as moves) with parsing their FENs, on the
+// positions of random games. Returns false if a packed position didn't read back the same.
+static bool packed_benchmark(std::size_t game_count) {
+	std::vector<Position> positions = random_game_positions(game_count);
+	std::vector<std::string> fens{};
+	std::size_t fen_bytes{};
+	for (const Position& position : positions) {
+		fens.push_back(position.get_fen());
+		fen_bytes += fens.back().size() + 1;
+	}
+	std::cout << "Format            Bytes/position  Million positions/s" << '\n';
+	Position position{};
+	U64 key_sum{};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (const std::string& fen : fens) {
+		position.set_fen(fen);
+		key_sum += position.get_key();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	auto print_row = [&positions](const char* format, double bytes, double row_seconds) {
+		std::cout << std::left << std::setw(18) << format << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(14) << bytes / static_cast<double>(positions.size()) << std::setprecision(2) << std::setw(21)
+			<< static_cast<double>(positions.size()) / row_seconds / 1e6 << '\n';
+		std::cout.unsetf(std::ios::fixed);
+	};
+	print_row("FEN", static_cast<double>(fen_bytes), seconds);
+	bool all_matched{ true };
+	for (bool chain_moves : { false, true }) {
+		std::stringstream stream{};
+		{
+			PackedWriter writer{ stream, 0, chain_moves };
+			for (const Position& game_position : positions)
+				writer.write(game_position);
+		}
+		std::string packed_data = stream.str();
+		std::istringstream input{ packed_data };
+		PackedReader reader{ input };
+		PackedRecordData data{};
+		U64 packed_key_sum{};
+		start = std::chrono::steady_clock::now();
+		while (reader.read(position, data))
+			packed_key_sum += position.get_key();
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		all_matched = all_matched && packed_key_sum == key_sum;
+		print_row(chain_moves ? "Packed, chained" : "Packed", static_cast<double>(packed_data.size()), seconds);
+	}
+	std::cout << (all_matched ? "All positions read back the same." : "Packed positions DIFFER.") << '\n';
+	return all_matched;
+}
+
+// This function runs the benchmark command line mode: "bench <name> [arguments]". Returns the exit code of the program.
+int bench_command(const std::vector<std::string>& arguments) {
+	try {
+		if (arguments.empty())
+			throw "missing benchmark name.";
+		// Copy-make against make/unmake perft on the reference positions (default depth 4).
+		if (arguments[0] == "makemove") {
+			int depth = arguments.size() > 1 ? std::stoi(arguments[1]) : 4;
+			if (depth < 1) throw "depth has to be at least 1.";
+			return make_move_benchmark(depth) ? 0 : 1;
+		}
+		// Runtime color branches against color templates in the move generator (default depth 5).
+		if (arguments[0] == "movegen") {
+			int depth = arguments.size() > 1 ? std::stoi(arguments[1]) : 5;
+			if (depth < 1) throw "depth has to be at least 1.";
+			return movegen_benchmark(depth) ? 0 : 1;
+		}
+		// Network kernels and incremental accumulators on perft trees (default depth 3, random network without a file).
+		if (arguments[0] == "nnue") {
+			int depth = arguments.size() > 1 ? std::stoi(arguments[1]) : 3;
+			if (depth < 1 || depth >= MAX_PLY) throw "depth has to be between 1 and 127.";
+			return network_benchmark(arguments.size() > 2 ? arguments[2] : std::string{}, depth) ? 0 : 1;
+		}
+		// Fixed depth search of the reference positions (default depth 6).
+		if (arguments[0] == "search") {
+			int depth = arguments.size() > 1 ? std::stoi(arguments[1]) : 6;
+			if (depth < 1 || depth >= MAX_PLY) throw "depth has to be between 1 and 127.";
+			search_benchmark(depth);
+			return 0;
+		}
+		// Lazy SMP time to depth (default depth 6, up to all cores).
+		if (arguments[0] == "smp") {
+			int depth = arguments.size() > 1 ? std::stoi(arguments[1]) : 6;
+			std::size_t max_threads = arguments.size() > 2 ? std::stoul(arguments[2]) : std::thread::hardware_concurrency();
+			if (depth < 1 || depth >= MAX_PLY) throw "depth has to be between 1 and 127.";
+			smp_benchmark(depth, std::clamp<std::size_t>(max_threads, 1, MAX_SEARCH_THREADS));
+			return 0;
+		}
+		// Concurrent transposition table stores and probes (default 16 MB, all cores).
+		if (arguments[0] == "tt") {
+			std::size_t megabytes = arguments.size() > 1 ? std::stoul(arguments[1]) : DEFAULT_HASH_MEGABYTES;
+			std::size_t thread_count = arguments.size() > 2 ? std::stoul(arguments[2]) : std::thread::hardware_concurrency();
+			if (thread_count == 0) thread_count = 1;
+			return tt_benchmark(megabytes, thread_count) ? 0 : 1;
+		}
+		// FEN parsing speed (default 1000000 passes over the reference positions).
+		if (arguments[0] == "fen") {
+			std::uint64_t repetitions = arguments.size() > 1 ? std::stoull(arguments[1]) : 1000000;
+			return fen_benchmark(repetitions) ? 0 : 1;
+		}
+		// Packed position reading against FEN parsing (default 1000 random games).
+		if (arguments[0] == "packed") {
+			std::size_t game_count = arguments.size() > 1 ? std::stoul(arguments[1]) : 1000;
+			return packed_benchmark(game_count) ? 0 : 1;
+		}
+		throw "unknown benchmark.";
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << '\n';
+		std::cerr << "Usage: bench makemove [depth] | bench movegen [depth] | bench nnue [depth] [network file] | bench search [depth] | bench smp [depth] [threads] | bench tt [megabytes] [threads] | bench fen [repetitions] | bench packed [games]" << '\n';
+		return 1;
+	}
+	catch (const std::exception&) {
+		std::cerr << "Error: arguments have to be numbers." << '\n';
+		return 1;
+	}
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// This function runs the benchmark command line mode: "bench <name> [arguments]". Returns the exit code of the program.
+int bench_command(const std::vector<std::string>& arguments);
@@ -9,7 +9,17 @@
 #include <bitset>
 #include <algorithm>
 #include <random>
+#include "attacks.h"
+#include "batch.h"
+#include "bench.h"
+#include "evaluate.h"
 #include "game_class.h"
+#include "nnue.h"
+#include "packed_position.h"
+#include "perft.h"
+#include "selfplay.h"
+#include "tt.h"
+#include "uci.h"
 
 // This function prints a human-readable ascii board representation.
 //void print_board_ascii(FenData& game) {
@@ -25,14 +35,61 @@
 //	}
 //}
 
-int main()
+int main(int argc, char* argv[])
 {
+	// Build the sliding piece attack tables before anything generates moves.
+	init_attack_tables();
+	transposition_table.resize(DEFAULT_HASH_MEGABYTES);
+	// The network is used if its file is in the working directory, otherwise the evaluation is the classical one.
+	const char* network_error = load_network(DEFAULT_NETWORK_FILE);
+	// GUIs only expect UCI output, so nothing else is printed in UCI mode.
+	if (argc > 1 && std::string{ argv[1] } == "uci")
+		return uci_loop(false);
+	// Batch results are written to the standard output, so nothing else is printed there either.
+	if (argc > 1 && std::string{ argv[1] } == "batch")
+		return batch_command(std::vector<std::string>(argv + 2, argv + argc));
+	std::cout << attack_tables_info() << '\n';
+	std::cout << transposition_table.info() << '\n';
+	std::cout << network_info();
+	if (network_error) std::cout << " (" << DEFAULT_NETWORK_FILE << ": " << network_error << ")";
+	std::cout << '\n';
+	// Command line modes: "uci", "batch <file> <operation> [depth] [options]",
+	// "pack <text file> <packed file> [fields]", "unpack <packed file> <text file>", "selfplay [options]", "eval <fen or file>", "perft <depth> [options] [fen]", "perft suite [depth] [options]" and "bench <name>".
+	if (argc > 1) {
+		std::string mode{ argv[1] };
+		std::vector<std::string> arguments(argv + 2, argv + argc);
+		if (mode == "perft")
+			return perft_command(arguments);
+		if (mode == "pack")
+			return pack_command(arguments);
+		if (mode == "unpack")
+			return unpack_command(arguments);
+		if (mode == "eval")
+			return eval_command(arguments);
+		if (mode == "selfplay")
+			return selfplay_command(arguments);
+		if (mode == "bench")
+			return bench_command(arguments);
+		std::cerr << "Unknown mode: " << mode << '\n';
+		return 1;
+	}
 	std::string fen{};
 	// U64 test{ ~uint64_t(0) };
 	std::cout << "Please, enter the FEN or press enter to start the game from the beginning: ";
 	std::getline(std::cin, fen);
+	// A GUI started the engine without arguments and opened the UCI session.
+	if (fen == "uci")
+		return uci_loop(true);
 	// Add "pl_color" value to the game class (1 - white, 0 - black);
-	GameData gameData = fen.length() > 5 ? GameData::create_game_object_from_fen(fen) : GameData::create_game_object_start_pos();
+	GameData gameData = GameData::create_game_object_start_pos();
+	try {
+		if (fen.length() > 5)
+			gameData = GameData::create_game_object_from_fen(fen);
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: invalid FEN: " << exception << '\n';
+		return 1;
+	}
 	std::string pl_color{};
 	std::cout << "Please, enter w to choose white and b to choose black pieces: ";
 	std::getline(std::cin, pl_color);
@@ -51,6 +108,6 @@ int main()
 	//piece_moves.insert(std::end(piece_moves), std::begin(white_pawn_moves), std::end(white_pawn_moves));
 	//for (std::pair<size_t, size_t> pawn_move : piece_moves)
 	//	std::cout << pawn_move.first << pawn_move.second << std::endl;
-	gameData.struct_to_fen();
+	std::cout << "FEN of the final position: " << gameData.get_fen() << '\n';
 	return 0;
 }
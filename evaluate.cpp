@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "attacks.h"
+#include "evaluate.h"
+#include "nnue.h"
+
+// Mobility: bonus for every square a piece attacks that isn't taken by an own piece or attacked by an opponent's pawn,
+// counted from a typical number of such squares. Indexed by the piece type.
+static constexpr std::array<Score, 6> MOBILITY_BONUS{ make_score(0, 0), make_score(4, 4), make_score(5, 5),
+	make_score(2, 4), make_score(1, 2), make_score(0, 0) };
+static constexpr std::array<int, 6> MOBILITY_BASE{ 0, 4, 7, 7, 14, 0 };
+
+// King safety: every attack on a square next to the opponent's king (or the king's square) adds the weight of the
+// attacking piece to the danger. The king is only in danger with at least two attackers, then the middlegame penalty
+// grows with the square of the danger (up to the maximum) and the endgame one linearly.
+static constexpr std::array<int, 6> KING_ATTACK_WEIGHTS{ 0, 2, 2, 3, 5, 0 };
+static constexpr int MIN_KING_ATTACKERS{ 2 };
+static constexpr int KING_DANGER_DIVISOR{ 4 };
+static constexpr int MAX_KING_DANGER_PENALTY{ 500 };
+
+// Bonus for every own pawn on the two ranks in front of the king and the files next to it.
+static constexpr Score PAWN_SHIELD_BONUS{ make_score(12, 0) };
+
+// Bonus for a passed pawn (no opponent's pawn in front of it on its file or the files next to it), indexed by the rank
+// from the pawn's side.
+static constexpr std::array<Score, 8> PASSED_PAWN_BONUS{ make_score(0, 0), make_score(5, 10), make_score(10, 15),
+	make_score(15, 25), make_score(25, 45), make_score(45, 75), make_score(70, 120), make_score(0, 0) };
+
+// Penalties for a pawn with another own pawn in front of it on its file, for a pawn without own pawns on the files
+// next to it, and for a backward pawn: one that no own pawn can defend when it advances, with the square in front of
+// it attacked by an opponent's pawn.
+static constexpr Score DOUBLED_PAWN_PENALTY{ make_score(10, 25) };
+static constexpr Score ISOLATED_PAWN_PENALTY{ make_score(8, 12) };
+static constexpr Score BACKWARD_PAWN_PENALTY{ make_score(8, 10) };
+
+static constexpr U64 A_FILE{ 0x0101010101010101ULL };
+
+// Files next to the file of the square.
+static constexpr std::array<U64, 64> ADJACENT_FILES = [] {
+	std::array<U64, 64> files{};
+	for (int square = 0; square < 64; ++square) {
+		int file = square % 8;
+		if (file > 0) files[static_cast<std::size_t>(square)] |= A_FILE << (file - 1);
+		if (file < 7) files[static_cast<std::size_t>(square)] |= A_FILE << (file + 1);
+	}
+	return files;
+}();
+
+// Squares an opponent's pawn has to stand on to stop a pawn of the color on the square from being passed: the squares
+// in front of it on its file and the files next to it. Indexed by color first (0 - black, 1 - white).
+static constexpr std::array<std::array<U64, 64>, 2> PASSED_PAWN_MASKS = [] {
+	std::array<std::array<U64, 64>, 2> masks{};
+	for (int square = 0; square < 64; ++square) {
+		int file = square % 8;
+		int rank = square / 8;
+		U64 files = A_FILE << file;
+		if (file > 0) files |= A_FILE << (file - 1);
+		if (file < 7) files |= A_FILE << (file + 1);
+		for (int other_rank = 0; other_rank < 8; ++other_rank) {
+			U64 rank_squares = files & (0xFFULL << (other_rank * 8));
+			if (other_rank > rank) masks[1][static_cast<std::size_t>(square)] |= rank_squares;
+			if (other_rank < rank) masks[0][static_cast<std::size_t>(square)] |= rank_squares;
+		}
+	}
+	return masks;
+}();
+
+// Data shared by the terms of one evaluation. Arrays are indexed by color (0 - black, 1 - white).
+struct EvalInfo {
+	U64 occupied;
+	// Pawn structure of the position, from the pawn hash table or computed for this evaluation.
+	PawnEntry* pawns;
+	std::array<U64, 2> king_zones;
+	// Attacks on the king zone of the color: number of attacking pieces and the danger they add up to.
+	std::array<int, 2> king_attackers;
+	std::array<int, 2> king_danger;
+};
+
+// This function returns the squares the piece attacks from the square.
+static U64 piece_attacks(int piece_type, int square, U64 occupied) {
+	switch (piece_type) {
+	case KNIGHT:
+		return KNIGHT_ATTACKS[static_cast<std::size_t>(square)];
+	case BISHOP:
+		return bishop_attacks(square, occupied);
+	case ROOK:
+		return rook_attacks(square, occupied);
+	default:
+		return queen_attacks(square, occupied);
+	}
+}
+
+// This function scores the mobility of the pieces of the color and adds their attacks on the opponent's king zone to
+// the king danger of the opponent.
+template <bool White>
+static Score evaluate_mobility(const Position& position, EvalInfo& info) {
+	U64 own_pieces = position.get_color_pieces(White);
+	U64 mobility_area = ~own_pieces & ~info.pawns->pawn_attacks[!White];
+	U64 opponent_king_zone = info.king_zones[!White];
+	Score score{};
+	for (int piece_type = KNIGHT; piece_type <= QUEEN; ++piece_type) {
+		U64 pieces = position.get_pieces(piece_type) & own_pieces;
+		std::size_t type_index = static_cast<std::size_t>(piece_type);
+		while (pieces) {
+			int square = std::countr_zero(pieces);
+			pieces &= pieces - 1;
+			U64 attacks = piece_attacks(piece_type, square, info.occupied);
+			score += MOBILITY_BONUS[type_index] * (std::popcount(attacks & mobility_area) - MOBILITY_BASE[type_index]);
+			if (U64 zone_attacks = attacks & opponent_king_zone) {
+				++info.king_attackers[!White];
+				info.king_danger[!White] += KING_ATTACK_WEIGHTS[type_index] * std::popcount(zone_attacks);
+			}
+		}
+	}
+	return score;
+}
+
+// This function returns the pawn shield score of the king of the color: the own pawns on the two ranks in front of
+// the king and the files next to it. It only depends on the pawns and the king square, so it's kept in the pawn entry.
+template <bool White>
+static Score king_shelter(const Position& position, PawnEntry& pawns) {
+	int king_square = position.get_king_square(White);
+	if (pawns.shelter_king_squares[White] != king_square) {
+		U64 king = 1ULL << king_square;
+		U64 king_files = king | ((king << 1) & NOT_A_FILE) | ((king >> 1) & NOT_H_FILE);
+		U64 first_rank = pawn_pushes(king_files, White);
+		U64 shield = first_rank | pawn_pushes(first_rank, White);
+		U64 own_pawns = position.get_pieces(PAWN) & position.get_color_pieces(White);
+		pawns.shelter_king_squares[White] = static_cast<std::int8_t>(king_square);
+		pawns.shelter[White] = PAWN_SHIELD_BONUS * std::popcount(own_pawns & shield);
+	}
+	return pawns.shelter[White];
+}
+
+// This function scores the safety of the king of the color: the danger from the attacks on its zone and the pawn
+// shield in front of it.
+template <bool White>
+static Score evaluate_king_safety(const Position& position, const EvalInfo& info) {
+	Score score{};
+	if (info.king_attackers[White] >= MIN_KING_ATTACKERS) {
+		int danger = info.king_danger[White];
+		score -= make_score(std::min(danger * danger / KING_DANGER_DIVISOR, MAX_KING_DANGER_PENALTY), danger);
+	}
+	return score + king_shelter<White>(position, *info.pawns);
+}
+
+// This function scores the passed pawns of the color (found by the pawn structure evaluation).
+template <bool White>
+static Score evaluate_passed_pawns(const EvalInfo& info) {
+	U64 passed_pawns = info.pawns->passed_pawns[White];
+	Score score{};
+	while (passed_pawns) {
+		int square = std::countr_zero(passed_pawns);
+		passed_pawns &= passed_pawns - 1;
+		int relative_rank = White ? square / 8 : 7 - square / 8;
+		score += PASSED_PAWN_BONUS[static_cast<std::size_t>(relative_rank)];
+	}
+	return score;
+}
+
+// This function finds the passed pawns of the color and scores its doubled, isolated and backward pawns. The pawn
+// attacks of both colors have to be in the entry already.
+template <bool White>
+static Score evaluate_pawn_structure(const Position& position, PawnEntry& pawns) {
+	U64 own_pawns = position.get_pieces(PAWN) & position.get_color_pieces(White);
+	U64 opponent_pawns = position.get_pieces(PAWN) & position.get_color_pieces(!White);
+	Score score{};
+	U64 remaining = own_pawns;
+	while (remaining) {
+		int square = std::countr_zero(remaining);
+		remaining &= remaining - 1;
+		std::size_t square_index = static_cast<std::size_t>(square);
+		U64 front_span = PASSED_PAWN_MASKS[White][square_index];
+		U64 file_ahead = front_span & (A_FILE << (square % 8));
+		if (!(front_span & opponent_pawns))
+			pawns.passed_pawns[White] |= 1ULL << square;
+		if (own_pawns & file_ahead)
+			score -= DOUBLED_PAWN_PENALTY;
+		if (!(own_pawns & ADJACENT_FILES[square_index]))
+			score -= ISOLATED_PAWN_PENALTY;
+		else {
+			// No own pawn can ever defend the square in front (it's outside their attack spans), and an opponent's
+			// pawn attacks it.
+			U64 stop_square = pawn_pushes(1ULL << square, White);
+			if (stop_square & ~pawns.attack_spans[White] & pawns.pawn_attacks[!White])
+				score -= BACKWARD_PAWN_PENALTY;
+		}
+	}
+	return score;
+}
+
+// This function returns the squares attacked by the pawns now or after they advance: the pawn attacks filled towards
+// the opponent's side.
+template <bool White>
+static U64 pawn_attack_span(U64 pawn_attacks) {
+	U64 span = pawn_attacks;
+	if constexpr (White) {
+		span |= span << 8;
+		span |= span << 16;
+		span |= span << 32;
+	}
+	else {
+		span |= span >> 8;
+		span |= span >> 16;
+		span |= span >> 32;
+	}
+	return span;
+}
+
+// This function fills the pawn entry of the position: the pawn attacks and attack spans, the passed pawns and the
+// pawn structure score. The king shelters are computed when they are needed.
+static void evaluate_pawns(const Position& position, PawnEntry& pawns) {
+	pawns = PawnEntry{};
+	pawns.key = position.get_pawn_key();
+	for (bool white : { false, true }) {
+		U64 own_pawns = position.get_pieces(PAWN) & position.get_color_pieces(white);
+		pawns.pawn_attacks[white] = pawn_west_captures(own_pawns, white) | pawn_east_captures(own_pawns, white);
+	}
+	pawns.attack_spans[1] = pawn_attack_span<true>(pawns.pawn_attacks[1]);
+	pawns.attack_spans[0] = pawn_attack_span<false>(pawns.pawn_attacks[0]);
+	pawns.score = evaluate_pawn_structure<true>(position, pawns) - evaluate_pawn_structure<false>(position, pawns);
+}
+
+// This function evaluates the position from the point of view of the side to move. The material and piece-square part
+// is either the incremental one of the position or computed from scratch. The pawn structure comes from the pawn
+// table if there is one.
+template <bool Incremental>
+static int evaluate_position(const Position& position, EvalTrace* trace, PawnTable* pawn_table) {
+	EvalInfo info{};
+	info.occupied = position.get_occupied();
+	PawnEntry local_pawns;
+	bool found{};
+	info.pawns = pawn_table ? &pawn_table->probe(position.get_pawn_key(), found) : &local_pawns;
+	if (!found) evaluate_pawns(position, *info.pawns);
+	for (bool white : { false, true }) {
+		int king_square = position.get_king_square(white);
+		info.king_zones[white] = KING_ATTACKS[static_cast<std::size_t>(king_square)] | 1ULL << king_square;
+	}
+
+	Score material_psq = Incremental ? position.get_psq_score() : position.compute_psq_score();
+	Score mobility = evaluate_mobility<true>(position, info) - evaluate_mobility<false>(position, info);
+	Score king_safety = evaluate_king_safety<true>(position, info) - evaluate_king_safety<false>(position, info);
+	Score pawn_structure = info.pawns->score;
+	Score passed_pawns = evaluate_passed_pawns<true>(info) - evaluate_passed_pawns<false>(info);
+	int phase = std::min(Incremental ? position.get_phase() : position.compute_phase(), MAX_PHASE);
+	if (trace)
+		*trace = { material_psq, mobility, king_safety, pawn_structure, passed_pawns, phase };
+
+	// Blend the middlegame and endgame values by the phase.
+	Score total = material_psq + mobility + king_safety + pawn_structure + passed_pawns;
+	int score = (middlegame_value(total) * phase + endgame_value(total) * (MAX_PHASE - phase)) / MAX_PHASE;
+	return position.get_active_color() ? score : -score;
+}
+
+// This function evaluates the position from the point of view of the side to move (positive - the side to move is
+// better), in centipawns. The material and piece-square part is kept up to date by the position, the other terms are
+// computed here, the pawn structure only if it isn't in the pawn table yet. With a trace the terms are written into
+// it.
+int evaluate(const Position& position, EvalTrace* trace, PawnTable* pawn_table) {
+	return evaluate_position<true>(position, trace, pawn_table);
+}
+
+// This function evaluates the position like evaluate, but computes the material and piece-square part from scratch.
+// It's only used to check and benchmark the incremental version.
+int evaluate_from_scratch(const Position& position) {
+	return evaluate_position<false>(position, nullptr, nullptr);
+}
+
+// This function prints the terms of the evaluation of the position.
+static void print_evaluation(const Position& position) {
+	EvalTrace trace{};
+	int score = evaluate(position, &trace);
+	auto print_term = [](const char* name, Score term) {
+		std::cout << std::left << std::setw(20) << name << std::right << std::setw(12) << middlegame_value(term)
+			<< std::setw(10) << endgame_value(term) << '\n';
+	};
+	std::cout << "Term                  Middlegame   Endgame" << '\n';
+	print_term("Material and PSQ", trace.material_psq);
+	print_term("Mobility", trace.mobility);
+	print_term("King safety", trace.king_safety);
+	print_term("Pawn structure", trace.pawn_structure);
+	print_term("Passed pawns", trace.passed_pawns);
+	print_term("Total", trace.material_psq + trace.mobility + trace.king_safety + trace.pawn_structure
+		+ trace.passed_pawns);
+	std::cout << "Phase: " << trace.phase << "/" << MAX_PHASE << '\n';
+	std::cout << "Evaluation (White's point of view): " << (position.get_active_color() ? score : -score) << '\n';
+	if (network_loaded()) {
+		int network_score = evaluate_network(position);
+		std::cout << "Network evaluation (White's point of view): "
+			<< (position.get_active_color() ? network_score : -network_score) << '\n';
+	}
+}
+
+// This function measures evaluations per second over the positions, with the incremental material and piece-square
+// score, with the one computed from scratch and with a pawn hash table. Returns false if the versions didn't agree.
+static bool evaluation_benchmark(const std::vector<Position>& positions, std::uint64_t repetitions) {
+	std::uint64_t evaluations = repetitions * positions.size();
+	std::cout << "Positions: " << positions.size() << ", evaluations: " << evaluations << '\n';
+	std::int64_t incremental_sum{};
+	std::int64_t scratch_sum{};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::uint64_t i = 0; i < repetitions; ++i)
+		for (const Position& position : positions)
+			incremental_sum += evaluate(position);
+	double incremental_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	start = std::chrono::steady_clock::now();
+	for (std::uint64_t i = 0; i < repetitions; ++i)
+		for (const Position& position : positions)
+			scratch_sum += evaluate_from_scratch(position);
+	double scratch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	PawnTable pawn_table{};
+	std::int64_t pawn_table_sum{};
+	start = std::chrono::steady_clock::now();
+	for (std::uint64_t i = 0; i < repetitions; ++i)
+		for (const Position& position : positions)
+			pawn_table_sum += evaluate(position, nullptr, &pawn_table);
+	double pawn_table_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Incremental PSQ:  " << static_cast<double>(evaluations) / incremental_seconds / 1e6
+		<< " million evaluations per second" << '\n';
+	std::cout << "From scratch PSQ: " << static_cast<double>(evaluations) / scratch_seconds / 1e6
+		<< " million evaluations per second" << '\n';
+	std::cout << "Pawn hash table:  " << static_cast<double>(evaluations) / pawn_table_seconds / 1e6
+		<< " million evaluations per second, " << 100.0 * static_cast<double>(pawn_table.hits())
+		/ static_cast<double>(pawn_table.probes()) << "% hits" << '\n';
+	std::cout.unsetf(std::ios::fixed);
+	bool matched = incremental_sum == scratch_sum && incremental_sum == pawn_table_sum;
+	std::cout << (matched ? "All versions agree." : "The versions DIFFER.") << '\n';
+	return matched;
+}
+
+// This function runs the evaluation command line mode: "eval <fen>" prints the terms of the evaluation, and
+// "eval <file> [repetitions]" measures evaluations per second over the FEN or EPD lines of the file. Returns the exit
+// code of the program.
+int eval_command(const std::vector<std::string>& arguments) {
+	try {
+		if (arguments.empty()) throw "missing FEN or file name.";
+		Position position{};
+		std::ifstream file(arguments[0]);
+		if (!file) {
+			// The FEN comes split into the command line arguments.
+			std::string fen{};
+			for (const std::string& argument : arguments)
+				fen += (fen.empty() ? "" : " ") + argument;
+			if (const char* error = position.set_fen(fen)) throw error;
+			print_evaluation(position);
+			return 0;
+		}
+		std::vector<Position> positions{};
+		std::string line{};
+		while (std::getline(file, line)) {
+			std::string_view fen = fen_of_line(line);
+			if (!fen.empty() && !position.set_fen(fen))
+				positions.push_back(position);
+		}
+		if (positions.empty()) throw "the file has no valid positions.";
+		// About a million evaluations by default.
+		std::uint64_t repetitions = arguments.size() > 1 ? std::stoull(arguments[1])
+			: std::max<std::uint64_t>(1, 1000000 / positions.size());
+		return evaluation_benchmark(positions, std::max<std::uint64_t>(repetitions, 1)) ? 0 : 1;
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << '\n';
+		std::cerr << "Usage: eval <fen> | eval <file> [repetitions]" << '\n';
+		return 1;
+	}
+	catch (const std::exception&) {
+		std::cerr << "Error: repetitions have to be a number." << '\n';
+		return 1;
+	}
+}
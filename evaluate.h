@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include "pawns.h"
+#include "position.h"
+#include "psqt.h"
+
+// Piece values in centipawns (the king has no material value).
+inline constexpr std::array<int, 6> PIECE_VALUES{ 100, 320, 330, 500, 900, 0 };
+
+// Terms of the evaluation from White's point of view, before they are blended by the game phase.
+struct EvalTrace {
+	Score material_psq{};
+	Score mobility{};
+	Score king_safety{};
+	Score pawn_structure{};
+	Score passed_pawns{};
+	int phase{};
+};
+
+// This function evaluates the position from the point of view of the side to move (positive - the side to move is
+// better), in centipawns. The material and piece-square part is kept up to date by the position, the other terms are
+// computed here, the pawn structure only if it isn't in the pawn table yet. With a trace the terms are written into
+// it.
+int evaluate(const Position& position, EvalTrace* trace = nullptr, PawnTable* pawn_table = nullptr);
+
+// This function evaluates the position like evaluate, but computes the material and piece-square part from scratch.
+// It's only used to check and benchmark the incremental version.
+int evaluate_from_scratch(const Position& position);
+
+// This function runs the evaluation command line mode: "eval <fen>" prints the terms of the evaluation, and
+// "eval <file> [repetitions]" measures evaluations per second over the FEN or EPD lines of the file. Returns the exit
+// code of the program.
+int eval_command(const std::vector<std::string>& arguments);
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include "position.h"
+
+// Piece letters of the FEN: white pieces (upper case) by piece type, then black pieces (lower case).
+static constexpr std::string_view FEN_PIECE_LETTERS{ "PNBRQKpnbrqk" };
+
+// Castling letters of the FEN in the order of the castling rights bits.
+static constexpr std::string_view FEN_CASTLING_LETTERS{ "KQkq" };
+
+// King and rook squares that castling rights need (in the order of the castling rights bits).
+static constexpr std::array<int, 4> CASTLING_KING_SQUARES{ e1, e1, e8, e8 };
+static constexpr std::array<int, 4> CASTLING_ROOK_SQUARES{ h1, a1, h8, a8 };
+
+// Largest values of the counters that fit into the position.
+static constexpr unsigned MAX_HALFMOVE_CLOCK{ 255 };
+static constexpr unsigned MAX_FULLMOVE_NUMBER{ 65535 };
+
+// This function writes the counter into the buffer and returns the position after it.
+static char* write_fen_counter(char* buffer, unsigned value) {
+	return std::to_chars(buffer, buffer + 5, value).ptr;
+}
+
+// This function checks for the characters that separate the FEN fields.
+static bool is_fen_space(char character) {
+	return character == ' ' || character == '\t' || character == '\r' || character == '\n';
+}
+
+// This function returns the next field of the FEN starting at index and moves index past it. The field is empty if
+// there are no more fields.
+static std::string_view next_fen_field(std::string_view fen, std::size_t& index) {
+	while (index < fen.size() && is_fen_space(fen[index])) ++index;
+	std::size_t start = index;
+	while (index < fen.size() && !is_fen_space(fen[index])) ++index;
+	return fen.substr(start, index - start);
+}
+
+// This function reads the counter field. Returns false if it's not a number or it's larger than max_value.
+static bool parse_fen_counter(std::string_view field, unsigned max_value, unsigned& value) {
+	std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), value);
+	return result.ec == std::errc{} && result.ptr == field.data() + field.size() && value <= max_value;
+}
+
+// This function returns the FEN part of the line: the first four fields and the counters if they follow (EPD lines
+// have operations like "bm e4;" there instead).
+std::string_view fen_of_line(std::string_view line) {
+	std::size_t index{};
+	std::size_t fen_end{};
+	for (int field = 0; field < 6; ++field) {
+		std::string_view field_text = next_fen_field(line, index);
+		if (field_text.empty()) break;
+		if (field >= 4 && !std::all_of(field_text.begin(), field_text.end(), [](char character) {
+			return character >= '0' && character <= '9';
+		}))
+			break;
+		fen_end = index;
+	}
+	return line.substr(0, fen_end);
+}
+
+// This function sets the position from the FEN string in one pass, without copying the string or allocating memory.
+// The halfmove clock and the fullmove number may be left out (as in EPD), they are 0 and 1 then. Returns nullptr if
+// the FEN is a valid position, otherwise a description of the error (the position is unusable then).
+const char* Position::set_fen(std::string_view fen) {
+	*this = Position{};
+	fill_mailbox();
+	std::size_t index{};
+
+	// Board: ranks from the 8th to the 1st, files from a to h, digits for the empty squares.
+	std::string_view board = next_fen_field(fen, index);
+	if (board.empty()) return "the FEN is empty.";
+	int rank{ 7 };
+	int file{};
+	for (char character : board) {
+		if (character == '/') {
+			if (file != 8) return "every rank of the board has to have 8 squares.";
+			if (rank == 0) return "the board has more than 8 ranks.";
+			--rank;
+			file = 0;
+		}
+		else if (character >= '1' && character <= '8') {
+			file += character - '0';
+			if (file > 8) return "every rank of the board has to have 8 squares.";
+		}
+		else {
+			std::size_t letter_index = FEN_PIECE_LETTERS.find(character);
+			if (letter_index == std::string_view::npos) return "invalid piece letter on the board.";
+			if (file == 8) return "every rank of the board has to have 8 squares.";
+			put_piece(static_cast<int>(letter_index % 6), letter_index < 6, rank * 8 + file);
+			++file;
+		}
+	}
+	if (rank != 0 || file != 8) return "the board has to have 8 ranks of 8 squares.";
+
+	// Side to move.
+	std::string_view active_color = next_fen_field(fen, index);
+	if (active_color != "w" && active_color != "b") return "the side to move has to be w or b.";
+	m_active_color = active_color == "w";
+
+	// Castling rights: "-" or letters from "KQkq".
+	std::string_view castling = next_fen_field(fen, index);
+	if (castling.empty()) return "missing castling rights.";
+	if (castling != "-") {
+		for (char character : castling) {
+			std::size_t right_index = FEN_CASTLING_LETTERS.find(character);
+			if (right_index == std::string_view::npos) return "castling rights have to be - or letters from KQkq.";
+			std::uint8_t right = static_cast<std::uint8_t>(1 << right_index);
+			if (m_castling_rights & right) return "a castling right is repeated.";
+			m_castling_rights |= right;
+		}
+	}
+
+	// En passant target square: "-" or the square a pawn of the side not to move has just skipped.
+	std::string_view en_passant = next_fen_field(fen, index);
+	if (en_passant.empty()) return "missing en passant target square.";
+	if (en_passant != "-") {
+		if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h'
+			|| en_passant[1] != (m_active_color ? '6' : '3'))
+			return "the en passant target square has to be - or a square on the 3rd or the 6th rank behind the pawn "
+				"that has just moved.";
+		m_en_passant_square = static_cast<std::int8_t>((en_passant[1] - '1') * 8 + (en_passant[0] - 'a'));
+	}
+
+	// Optional counters.
+	unsigned halfmove_clock{};
+	unsigned fullmove_number{ 1 };
+	std::string_view halfmove_field = next_fen_field(fen, index);
+	if (!halfmove_field.empty() && !parse_fen_counter(halfmove_field, MAX_HALFMOVE_CLOCK, halfmove_clock))
+		return "the halfmove clock has to be a number from 0 to 255.";
+	std::string_view fullmove_field = next_fen_field(fen, index);
+	if (!fullmove_field.empty() && !parse_fen_counter(fullmove_field, MAX_FULLMOVE_NUMBER, fullmove_number))
+		return "the fullmove number has to be a number from 0 to 65535.";
+	if (!next_fen_field(fen, index).empty()) return "unexpected text after the fullmove number.";
+	m_halfmove_clock = static_cast<std::uint8_t>(halfmove_clock);
+	m_fullmove_number = static_cast<std::uint16_t>(fullmove_number);
+	if (const char* error = check_rules()) return error;
+
+	// The en passant part of the key depends on the pawns and the side to move, so compute the whole key again.
+	m_key = compute_key();
+	return nullptr;
+}
+
+// This function checks that the position can occur in a game as far as the search relies on it: one king per side,
+// no pawns on the 1st or the 8th rank, the side that is not to move isn't in check, every castling right has the king
+// and the rook on their starting squares and the en passant target square follows a pawn's double step. Returns
+// nullptr if it does, otherwise a description of the error. Positions that come from outside (FEN, packed files) have
+// to pass it, otherwise the move generator could capture a king or read past its tables.
+const char* Position::check_rules() const {
+	if (std::popcount(m_all_pieces_bitboards[KING] & m_white_pieces) != 1
+		|| std::popcount(m_all_pieces_bitboards[KING] & m_black_pieces) != 1)
+		return "each side has to have exactly one king.";
+	if (m_all_pieces_bitboards[PAWN] & (RANK_1 | RANK_8)) return "pawns can't be on the 1st or the 8th rank.";
+	if (is_square_attacked(get_king_square(!m_active_color), m_active_color))
+		return "the side that is not to move is in check.";
+	for (std::size_t right_index = 0; right_index < FEN_CASTLING_LETTERS.size(); ++right_index) {
+		bool white = right_index < 2;
+		if ((m_castling_rights & (1 << right_index))
+			&& (piece_on(CASTLING_KING_SQUARES[right_index]) != make_piece(KING, white)
+				|| piece_on(CASTLING_ROOK_SQUARES[right_index]) != make_piece(ROOK, white)))
+			return "a castling right needs the king and the rook on their starting squares.";
+	}
+	if (m_en_passant_square >= 0) {
+		int square = m_en_passant_square;
+		int pawn_square = square + (m_active_color ? ONE_SQUARE_DOWN : ONE_SQUARE_UP);
+		int start_square = square + (m_active_color ? ONE_SQUARE_UP : ONE_SQUARE_DOWN);
+		if (square >> 3 != (m_active_color ? 5 : 2) || piece_on(pawn_square) != make_piece(PAWN, !m_active_color)
+			|| piece_on(square) != NO_PIECE || piece_on(start_square) != NO_PIECE)
+			return "the en passant target square doesn't follow a pawn's double step.";
+	}
+	return nullptr;
+}
+
+// This function writes the FEN of the position into the buffer (at least MAX_FEN_LENGTH characters, no terminating
+// zero) in one pass over the ranks and returns its length.
+std::size_t Position::write_fen(char* buffer) const {
+	char* end = buffer;
+	for (int rank = 7; rank >= 0; --rank) {
+		int empty_squares{};
+		for (int square = rank * 8; square < rank * 8 + 8; ++square) {
+			int piece = piece_on(square);
+			if (piece == NO_PIECE) {
+				++empty_squares;
+				continue;
+			}
+			if (empty_squares) *end++ = static_cast<char>('0' + empty_squares);
+			empty_squares = 0;
+			*end++ = FEN_PIECE_LETTERS[static_cast<std::size_t>(type_of_piece(piece) + (is_white_piece(piece) ? 0 : 6))];
+		}
+		if (empty_squares) *end++ = static_cast<char>('0' + empty_squares);
+		if (rank) *end++ = '/';
+	}
+	*end++ = ' ';
+	*end++ = m_active_color ? 'w' : 'b';
+	*end++ = ' ';
+	if (!m_castling_rights) *end++ = '-';
+	for (std::size_t right_index = 0; right_index < FEN_CASTLING_LETTERS.size(); ++right_index)
+		if (m_castling_rights & (1 << right_index)) *end++ = FEN_CASTLING_LETTERS[right_index];
+	*end++ = ' ';
+	if (m_en_passant_square < 0) *end++ = '-';
+	else {
+		*end++ = static_cast<char>('a' + (m_en_passant_square & 7));
+		*end++ = static_cast<char>('1' + (m_en_passant_square >> 3));
+	}
+	*end++ = ' ';
+	end = write_fen_counter(end, m_halfmove_clock);
+	*end++ = ' ';
+	end = write_fen_counter(end, m_fullmove_number);
+	return static_cast<std::size_t>(end - buffer);
+}
+
+// This function returns the FEN of the position.
+std::string Position::get_fen() const {
+	std::array<char, MAX_FEN_LENGTH> buffer;
+	return std::string(buffer.data(), write_fen(buffer.data()));
+}
@@ -0,0 +1,69 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// This function unmaps and closes the file.
+void MappedFile::release() {
+#if defined(_WIN32)
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file) CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data) munmap(const_cast<char*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+}
+
+// This function maps the file into memory. With sequential, the system is told that the file is read from the start
+// to the end, so it can read ahead and drop the pages behind. Throws the description of the error if it's not possible.
+MappedFile::MappedFile(const std::string& path, bool sequential) {
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw "can't open the file.";
+	m_file = file;
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size)) {
+		release();
+		throw "can't read the file size.";
+	}
+	m_size = static_cast<std::size_t>(size.QuadPart);
+	if (!m_size) return;
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping) m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data) {
+		release();
+		throw "can't map the file into memory.";
+	}
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) throw "can't open the file.";
+	struct stat file_status {};
+	if (fstat(file, &file_status) != 0) {
+		close(file);
+		throw "can't read the file size.";
+	}
+	m_size = static_cast<std::size_t>(file_status.st_size);
+	if (m_size) {
+		void* memory = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (memory == MAP_FAILED) {
+			close(file);
+			throw "can't map the file into memory.";
+		}
+		madvise(memory, m_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+		m_data = static_cast<const char*>(memory);
+	}
+	close(file);
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. The data is read straight from the mapping, so a file of any size is used
+// without copying it and only the pages being read have to be in memory.
+class MappedFile {
+	const char* m_data{};
+	std::size_t m_size{};
+	// Windows file and mapping handles (unused elsewhere).
+	void* m_file{};
+	void* m_mapping{};
+
+	// This function unmaps and closes the file.
+	void release();
+
+public:
+	// This function maps the file into memory. With sequential, the system is told that the file is read from the
+	// start to the end, so it can read ahead and drop the pages behind. Throws the description of the error if it's
+	// not possible.
+	MappedFile(const std::string& path, bool sequential);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		release();
+	}
+
+	// This function returns the contents of the file.
+	std::string_view contents() const { return { m_data, m_size }; }
+};
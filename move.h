@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Packed move: bits 0-5 hold the "move from" square, bits 6-11 the "move to" square and bits 12-15 the move flags.
+typedef std::uint16_t Move;
+
+// Null move (a1a1) is never generated, so it's used as "no move".
+constexpr Move NO_MOVE{ 0 };
+
+// Move flags (the upper 4 bits of the move). Bit 2 of the flags marks a capture, bit 3 marks a promotion, so promotion
+// captures are 12 - 15 and the promotion piece is (flags & 3) + knight.
+enum MoveFlag {
+	QUIET = 0,
+	DOUBLE_PAWN_PUSH = 1,
+	KING_CASTLE = 2,
+	QUEEN_CASTLE = 3,
+	CAPTURE = 4,
+	EN_PASSANT = 5,
+	KNIGHT_PROMOTION = 8,
+	BISHOP_PROMOTION = 9,
+	ROOK_PROMOTION = 10,
+	QUEEN_PROMOTION = 11,
+	KNIGHT_PROMOTION_CAPTURE = 12,
+	BISHOP_PROMOTION_CAPTURE = 13,
+	ROOK_PROMOTION_CAPTURE = 14,
+	QUEEN_PROMOTION_CAPTURE = 15
+};
+
+// This function packs "move from", "move to" and the flags into one move.
+constexpr Move encode_move(int move_from, int move_to, int flags) {
+	return static_cast<Move>(move_from | (move_to << 6) | (flags << 12));
+}
+
+// These functions unpack the parts of the move.
+constexpr int from_square(Move move) { return move & 0x3F; }
+constexpr int to_square(Move move) { return (move >> 6) & 0x3F; }
+constexpr int move_flags(Move move) { return move >> 12; }
+constexpr bool is_capture(Move move) { return (move_flags(move) & CAPTURE) != 0; }
+constexpr bool is_promotion(Move move) { return (move_flags(move) & KNIGHT_PROMOTION) != 0; }
+constexpr bool is_castling(Move move) { return move_flags(move) == KING_CASTLE || move_flags(move) == QUEEN_CASTLE; }
+
+// This function returns the piece type (bitboard number) the pawn is promoted to (1 - knight ... 4 - queen).
+constexpr int promotion_piece(Move move) { return (move_flags(move) & 3) + 1; }
+
+// This function converts the move into the UCI move string (e2e4, e7e8q).
+std::string move_to_string(Move move);
+
+// Fixed-capacity list of moves. It lives on the stack, so generating moves does no heap allocation. 256 is more than the
+// maximum number of legal moves in any chess position (218).
+struct MoveList {
+	static constexpr std::size_t CAPACITY{ 256 };
+
+	// Moves are left uninitialized on purpose, only the first "count" of them are valid.
+	std::array<Move, CAPACITY> moves;
+	std::size_t count{};
+
+	void push_back(Move move) { moves[count++] = move; }
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	Move operator[](std::size_t i) const { return moves[i]; }
+	Move* begin() { return moves.data(); }
+	Move* end() { return moves.data() + count; }
+	const Move* begin() const { return moves.data(); }
+	const Move* end() const { return moves.data() + count; }
+};
@@ -0,0 +1,541 @@
+#include <array>
+#include <bit>
+#include <string>
+#include "attacks.h"
+#include "position.h"
+
+#define set_bit(b, i) ((b) |= (1ULL << i))
+#define get_bit(b, i) ((b) & (1ULL << i))
+#define clear_bit(b, i) ((b) &= ~(1ULL << i))
+
+#define all_pieces m_white_pieces | m_black_pieces
+
+// This function adds a move from the square to every target square (captures are flagged).
+static void add_moves(MoveList& move_list, int move_from, U64 targets, U64 opponent_pieces) {
+	while (targets) {
+		int move_to = std::countr_zero(targets);
+		move_list.push_back(encode_move(move_from, move_to, get_bit(opponent_pieces, move_to) ? CAPTURE : QUIET));
+		targets &= targets - 1;
+	}
+}
+
+// This function adds a pawn move to every target square. The pawn came from the square "offset" behind the target.
+static void add_pawn_moves(MoveList& move_list, U64 targets, int offset, int flags) {
+	while (targets) {
+		int move_to = std::countr_zero(targets);
+		move_list.push_back(encode_move(move_to - offset, move_to, flags));
+		targets &= targets - 1;
+	}
+}
+
+// This function adds all 4 promotions for every target square of the promoting pawns.
+static void add_promotions(MoveList& move_list, U64 targets, int offset, bool capture) {
+	int flags = capture ? KNIGHT_PROMOTION_CAPTURE : KNIGHT_PROMOTION;
+	while (targets) {
+		int move_to = std::countr_zero(targets);
+		// Queen goes first, it's almost always the best promotion.
+		for (int i = 3; i >= 0; --i)
+			move_list.push_back(encode_move(move_to - offset, move_to, flags + i));
+		targets &= targets - 1;
+	}
+}
+
+// This function converts the move into the UCI move string (e2e4, e7e8q).
+std::string move_to_string(Move move) {
+	std::string move_string{ static_cast<char>('a' + from_square(move) % 8), static_cast<char>('1' + from_square(move) / 8),
+		static_cast<char>('a' + to_square(move) % 8), static_cast<char>('1' + to_square(move) / 8) };
+	if (is_promotion(move))
+		move_string += "nbrq"[promotion_piece(move) - KNIGHT];
+	return move_string;
+}
+
+// This function returns the square of the king of the selected color.
+int Position::get_king_square(bool white) const {
+	return std::countr_zero(m_all_pieces_bitboards[KING] & (white ? m_white_pieces : m_black_pieces));
+}
+
+// This function checks if the square is attacked by the pieces of the selected color.
+bool Position::is_square_attacked(int square, bool by_white) const {
+	U64 attackers = by_white ? m_white_pieces : m_black_pieces;
+	U64 occupied = all_pieces;
+	// A pawn attacks the square if a pawn of the other color standing on that square would attack the pawn.
+	if (PAWN_ATTACKS[!by_white][square] & m_all_pieces_bitboards[PAWN] & attackers) return true;
+	if (KNIGHT_ATTACKS[square] & m_all_pieces_bitboards[KNIGHT] & attackers) return true;
+	if (KING_ATTACKS[square] & m_all_pieces_bitboards[KING] & attackers) return true;
+	U64 diagonal_attackers = (m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN]) & attackers;
+	if (diagonal_attackers && (bishop_attacks(square, occupied) & diagonal_attackers)) return true;
+	U64 straight_attackers = (m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN]) & attackers;
+	if (straight_attackers && (rook_attacks(square, occupied) & straight_attackers)) return true;
+	return false;
+}
+
+// This function checks if the king of the side to move is in check.
+bool Position::is_in_check() const {
+	return is_square_attacked(get_king_square(m_active_color), !m_active_color);
+}
+
+// This function returns the pieces of both colors that attack the square when the occupied squares are the given
+// ones (so pieces can be removed or added for the test).
+U64 Position::attackers_to(int square, U64 occupied) const {
+	return (PAWN_ATTACKS[0][square] & m_all_pieces_bitboards[PAWN] & m_white_pieces)
+		| (PAWN_ATTACKS[1][square] & m_all_pieces_bitboards[PAWN] & m_black_pieces)
+		| (KNIGHT_ATTACKS[square] & m_all_pieces_bitboards[KNIGHT])
+		| (KING_ATTACKS[square] & m_all_pieces_bitboards[KING])
+		| (bishop_attacks(square, occupied) & (m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN]))
+		| (rook_attacks(square, occupied) & (m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN]));
+}
+
+// This function returns the opponent's pieces that give check to the king of the side to move.
+U64 Position::get_checkers() const {
+	return attackers_to(get_king_square(m_active_color), all_pieces) & get_opponent_pieces();
+}
+
+// This function returns the pieces of the side to move that are pinned to their king: the only piece between the
+// king and an opponent's slider on the same line.
+U64 Position::get_pinned_pieces() const {
+	int king_square = get_king_square(m_active_color);
+	U64 occupied = all_pieces;
+	// Sliders that would attack the king on an empty board.
+	U64 snipers = ((bishop_attacks(king_square, 0) & (m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN]))
+		| (rook_attacks(king_square, 0) & (m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN])))
+		& get_opponent_pieces();
+	U64 pinned{};
+	while (snipers) {
+		int sniper_square = std::countr_zero(snipers);
+		snipers &= snipers - 1;
+		U64 blockers = squares_between[king_square][sniper_square] & occupied;
+		if (blockers && !(blockers & (blockers - 1)))
+			pinned |= blockers & get_own_pieces();
+	}
+	return pinned;
+}
+
+// This function adds the pushes, captures and promotions of the pawns that land on the target squares (en passant
+// captures aren't included).
+void Position::generate_pawn_moves(MoveList& move_list, U64 pawns, U64 targets) const {
+	// Pawns are moved all at once by shifting the pawn bitboard. Direction, double push rank and promotion rank depend on
+	// the color.
+	bool white = m_active_color;
+	int up = white ? ONE_SQUARE_UP : ONE_SQUARE_DOWN;
+	int west = white ? ONE_SQUARE_LEFT_ONE_UP : ONE_SQUARE_LEFT_ONE_DOWN;
+	int east = white ? ONE_SQUARE_RIGHT_ONE_UP : ONE_SQUARE_RIGHT_ONE_DOWN;
+	U64 promotion_rank = white ? RANK_7 : RANK_2;
+	// Rank the pawns reach after the first step of a double push.
+	U64 double_push_rank = white ? RANK_2 << 8 : RANK_7 >> 8;
+	U64 empty = ~(all_pieces);
+	U64 capture_targets = get_opponent_pieces() & targets;
+	U64 promoting_pawns = pawns & promotion_rank;
+	U64 other_pawns = pawns & ~promotion_rank;
+
+	// The first step of a double push only has to be empty, the target mask applies to the square it ends on.
+	U64 single_pushes = pawn_pushes(other_pawns, white) & empty;
+	U64 double_pushes = pawn_pushes(single_pushes & double_push_rank, white) & empty & targets;
+	add_pawn_moves(move_list, single_pushes & targets, up, QUIET);
+	add_pawn_moves(move_list, double_pushes, up + up, DOUBLE_PAWN_PUSH);
+	add_pawn_moves(move_list, pawn_west_captures(other_pawns, white) & capture_targets, west, CAPTURE);
+	add_pawn_moves(move_list, pawn_east_captures(other_pawns, white) & capture_targets, east, CAPTURE);
+
+	if (promoting_pawns) {
+		add_promotions(move_list, pawn_pushes(promoting_pawns, white) & empty & targets, up, false);
+		add_promotions(move_list, pawn_west_captures(promoting_pawns, white) & capture_targets, west, true);
+		add_promotions(move_list, pawn_east_captures(promoting_pawns, white) & capture_targets, east, true);
+	}
+}
+
+// This function writes all pseudo-legal moves (moves that may leave own king in check) into the move list.
+void Position::generate_pseudo_legal_moves(MoveList& move_list) const {
+	U64 own_pieces = get_own_pieces();
+	U64 opponent_pieces = get_opponent_pieces();
+	U64 occupied = all_pieces;
+	U64 not_own_pieces = ~own_pieces;
+
+	bool white = m_active_color;
+	U64 pawns = m_all_pieces_bitboards[PAWN] & own_pieces;
+	generate_pawn_moves(move_list, pawns, ~EMPTY_BITBOARD);
+
+	// En passant. The pawns that can capture are the ones an opponent's pawn on the target square would attack.
+	int en_passant_square = m_en_passant_square;
+	if (en_passant_square >= 0) {
+		U64 en_passant_pawns = PAWN_ATTACKS[!white][en_passant_square] & pawns;
+		while (en_passant_pawns) {
+			move_list.push_back(encode_move(std::countr_zero(en_passant_pawns), en_passant_square, EN_PASSANT));
+			en_passant_pawns &= en_passant_pawns - 1;
+		}
+	}
+
+	// Knights.
+	U64 knights = m_all_pieces_bitboards[KNIGHT] & own_pieces;
+	while (knights) {
+		int move_from = std::countr_zero(knights);
+		knights &= knights - 1;
+		add_moves(move_list, move_from, KNIGHT_ATTACKS[move_from] & not_own_pieces, opponent_pieces);
+	}
+
+	// Bishops and queens along the diagonals.
+	U64 diagonal_sliders = (m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN]) & own_pieces;
+	while (diagonal_sliders) {
+		int move_from = std::countr_zero(diagonal_sliders);
+		diagonal_sliders &= diagonal_sliders - 1;
+		add_moves(move_list, move_from, bishop_attacks(move_from, occupied) & not_own_pieces, opponent_pieces);
+	}
+
+	// Rooks and queens along the ranks and files.
+	U64 straight_sliders = (m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN]) & own_pieces;
+	while (straight_sliders) {
+		int move_from = std::countr_zero(straight_sliders);
+		straight_sliders &= straight_sliders - 1;
+		add_moves(move_list, move_from, rook_attacks(move_from, occupied) & not_own_pieces, opponent_pieces);
+	}
+
+	// King.
+	int king_square = get_king_square(m_active_color);
+	add_moves(move_list, king_square, KING_ATTACKS[king_square] & not_own_pieces, opponent_pieces);
+
+	// Castling. The squares between the king and the rook have to be empty, and the king can't castle out of, through
+	// or into check (the last one is checked by the legality test).
+	U64 own_rooks = m_all_pieces_bitboards[ROOK] & own_pieces;
+	if (m_active_color) {
+		if ((m_castling_rights & WHITE_KING_SIDE) && king_square == e1 && get_bit(own_rooks, h1) && !(occupied & WHITE_KING_CASTLING_EMPTY)
+			&& !is_square_attacked(e1, false) && !is_square_attacked(f1, false))
+			move_list.push_back(encode_move(e1, g1, KING_CASTLE));
+		if ((m_castling_rights & WHITE_QUEEN_SIDE) && king_square == e1 && get_bit(own_rooks, a1) && !(occupied & WHITE_QUEEN_CASTLING_EMPTY)
+			&& !is_square_attacked(e1, false) && !is_square_attacked(d1, false))
+			move_list.push_back(encode_move(e1, c1, QUEEN_CASTLE));
+	}
+	else {
+		if ((m_castling_rights & BLACK_KING_SIDE) && king_square == e8 && get_bit(own_rooks, h8) && !(occupied & BLACK_KING_CASTLING_EMPTY)
+			&& !is_square_attacked(e8, true) && !is_square_attacked(f8, true))
+			move_list.push_back(encode_move(e8, g8, KING_CASTLE));
+		if ((m_castling_rights & BLACK_QUEEN_SIDE) && king_square == e8 && get_bit(own_rooks, a8) && !(occupied & BLACK_QUEEN_CASTLING_EMPTY)
+			&& !is_square_attacked(e8, true) && !is_square_attacked(d8, true))
+			move_list.push_back(encode_move(e8, c8, QUEEN_CASTLE));
+	}
+}
+
+// This function checks if the move (possibly from another position, like a hash or killer move) is pseudo-legal
+// here: it has to be one of the moves generate_pseudo_legal_moves would write. is_legal has to be checked too.
+bool Position::is_pseudo_legal(Move move) const {
+	int flags = move_flags(move);
+	// Flags 6 and 7 aren't used.
+	if (move == NO_MOVE || flags == EN_PASSANT + 1 || flags == EN_PASSANT + 2) return false;
+	bool white = m_active_color;
+	int move_from = from_square(move);
+	int move_to = to_square(move);
+	int piece = piece_on(move_from);
+	if (piece == NO_PIECE || is_white_piece(piece) != white) return false;
+	int piece_type = type_of_piece(piece);
+	U64 to_bit = 1ULL << move_to;
+	U64 occupied = all_pieces;
+	if (get_own_pieces() & to_bit) return false;
+	if (flags == EN_PASSANT)
+		return piece_type == PAWN && move_to == m_en_passant_square && (PAWN_ATTACKS[white][move_from] & to_bit);
+	// The capture flag has to match the target square.
+	if (is_capture(move) != ((get_opponent_pieces() & to_bit) != 0)) return false;
+
+	// Castling: the same conditions as in the generator (the "move to" square is checked by the legality test).
+	if (is_castling(move)) {
+		bool king_side = flags == KING_CASTLE;
+		int king_from = white ? e1 : e8;
+		int rook_from = king_side ? king_from + 3 : king_from - 4;
+		int step = king_side ? 1 : -1;
+		int right = white ? (king_side ? WHITE_KING_SIDE : WHITE_QUEEN_SIDE) : (king_side ? BLACK_KING_SIDE : BLACK_QUEEN_SIDE);
+		U64 empty = white ? (king_side ? WHITE_KING_CASTLING_EMPTY : WHITE_QUEEN_CASTLING_EMPTY)
+			: (king_side ? BLACK_KING_CASTLING_EMPTY : BLACK_QUEEN_CASTLING_EMPTY);
+		return piece_type == KING && move_from == king_from && move_to == king_from + 2 * step
+			&& (m_castling_rights & right) && piece_on(rook_from) == make_piece(ROOK, white) && !(occupied & empty)
+			&& !is_square_attacked(king_from, !white) && !is_square_attacked(king_from + step, !white);
+	}
+
+	if (piece_type == PAWN) {
+		// Pawns promote exactly when they reach the last rank.
+		if (is_promotion(move) != ((to_bit & (white ? RANK_8 : RANK_1)) != 0)) return false;
+		if (is_capture(move)) return (PAWN_ATTACKS[white][move_from] & to_bit) != 0;
+		int forward = white ? ONE_SQUARE_UP : ONE_SQUARE_DOWN;
+		if (flags == DOUBLE_PAWN_PUSH)
+			return get_bit(white ? RANK_2 : RANK_7, move_from) && move_to == move_from + 2 * forward
+				&& !(occupied & ((1ULL << (move_from + forward)) | to_bit));
+		return move_to == move_from + forward && !(occupied & to_bit);
+	}
+	if (is_promotion(move) || flags == DOUBLE_PAWN_PUSH) return false;
+
+	U64 attacks{};
+	switch (piece_type) {
+	case KNIGHT: attacks = KNIGHT_ATTACKS[move_from]; break;
+	case BISHOP: attacks = bishop_attacks(move_from, occupied); break;
+	case ROOK: attacks = rook_attacks(move_from, occupied); break;
+	case QUEEN: attacks = queen_attacks(move_from, occupied); break;
+	default: attacks = KING_ATTACKS[move_from]; break;
+	}
+	return (attacks & to_bit) != 0;
+}
+
+// This function checks that the pseudo-legal move doesn't leave own king in check. The move isn't made, the attacks
+// on the king are computed with the occupancy after the move.
+bool Position::is_legal(Move move) const {
+	int move_from = from_square(move);
+	int move_to = to_square(move);
+	U64 to_bit = 1ULL << move_to;
+	// En passant removes the captured pawn from behind the "move to" square.
+	U64 captured_bit = move_flags(move) == EN_PASSANT
+		? 1ULL << (move_to + (m_active_color ? ONE_SQUARE_DOWN : ONE_SQUARE_UP)) : to_bit;
+	U64 occupied = ((all_pieces) & ~(1ULL << move_from) & ~captured_bit) | to_bit;
+	int king_square = get_king_square(m_active_color);
+	if (king_square == move_from) king_square = move_to;
+	return !(attackers_to(king_square, occupied) & get_opponent_pieces() & ~captured_bit);
+}
+
+// Runtime color version of generate_legal_moves, kept to compare the color templates with (bench movegen).
+void Position::generate_legal_moves_runtime(MoveList& move_list) const {
+	bool white = m_active_color;
+	U64 own_pieces = get_own_pieces();
+	U64 opponent_pieces = get_opponent_pieces();
+	U64 occupied = all_pieces;
+	int king_square = get_king_square(white);
+	U64 checkers = attackers_to(king_square, occupied) & opponent_pieces;
+
+	// The king can't go to an attacked square. It's removed from the board for the test, otherwise it would hide the
+	// squares behind it on the line of a checking slider.
+	U64 occupied_without_king = occupied & ~(1ULL << king_square);
+	U64 king_targets = KING_ATTACKS[king_square] & ~own_pieces;
+	while (king_targets) {
+		int move_to = std::countr_zero(king_targets);
+		king_targets &= king_targets - 1;
+		if (!(attackers_to(move_to, occupied_without_king) & opponent_pieces))
+			move_list.push_back(encode_move(king_square, move_to, get_bit(opponent_pieces, move_to) ? CAPTURE : QUIET));
+	}
+	// In double check only the king can move.
+	if (checkers & (checkers - 1)) return;
+
+	// In check the other pieces have to capture the checker or block the check. Pinned pieces can only move along the
+	// line of the pin (so never out of a check).
+	U64 check_mask = checkers ? squares_between[king_square][std::countr_zero(checkers)] | checkers : ~EMPTY_BITBOARD;
+	U64 targets = ~own_pieces & check_mask;
+	U64 pinned = get_pinned_pieces();
+
+	U64 pawns = m_all_pieces_bitboards[PAWN] & own_pieces;
+	generate_pawn_moves(move_list, pawns & ~pinned, targets);
+	if (!checkers) {
+		U64 pinned_pawns = pawns & pinned;
+		while (pinned_pawns) {
+			int move_from = std::countr_zero(pinned_pawns);
+			pinned_pawns &= pinned_pawns - 1;
+			generate_pawn_moves(move_list, 1ULL << move_from, targets & line_through[king_square][move_from]);
+		}
+	}
+
+	// En passant is rare, and it can uncover a check along the rank of both pawns, so it's checked with is_legal.
+	int en_passant_square = m_en_passant_square;
+	if (en_passant_square >= 0) {
+		U64 en_passant_pawns = PAWN_ATTACKS[!white][en_passant_square] & pawns;
+		while (en_passant_pawns) {
+			Move move = encode_move(std::countr_zero(en_passant_pawns), en_passant_square, EN_PASSANT);
+			en_passant_pawns &= en_passant_pawns - 1;
+			if (is_legal(move))
+				move_list.push_back(move);
+		}
+	}
+
+	// Knights. A pinned knight can never move.
+	U64 knights = m_all_pieces_bitboards[KNIGHT] & own_pieces & ~pinned;
+	while (knights) {
+		int move_from = std::countr_zero(knights);
+		knights &= knights - 1;
+		add_moves(move_list, move_from, KNIGHT_ATTACKS[move_from] & targets, opponent_pieces);
+	}
+
+	// Bishops and queens along the diagonals.
+	U64 diagonal_sliders = (m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN]) & own_pieces;
+	while (diagonal_sliders) {
+		int move_from = std::countr_zero(diagonal_sliders);
+		diagonal_sliders &= diagonal_sliders - 1;
+		U64 pin_mask = get_bit(pinned, move_from) ? line_through[king_square][move_from] : ~EMPTY_BITBOARD;
+		add_moves(move_list, move_from, bishop_attacks(move_from, occupied) & targets & pin_mask, opponent_pieces);
+	}
+
+	// Rooks and queens along the ranks and files.
+	U64 straight_sliders = (m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN]) & own_pieces;
+	while (straight_sliders) {
+		int move_from = std::countr_zero(straight_sliders);
+		straight_sliders &= straight_sliders - 1;
+		U64 pin_mask = get_bit(pinned, move_from) ? line_through[king_square][move_from] : ~EMPTY_BITBOARD;
+		add_moves(move_list, move_from, rook_attacks(move_from, occupied) & targets & pin_mask, opponent_pieces);
+	}
+
+	// Castling. The king can't castle out of, through or into check, and the squares between the king and the rook have
+	// to be empty.
+	if (checkers) return;
+	U64 own_rooks = m_all_pieces_bitboards[ROOK] & own_pieces;
+	if (white) {
+		if ((m_castling_rights & WHITE_KING_SIDE) && king_square == e1 && get_bit(own_rooks, h1) && !(occupied & WHITE_KING_CASTLING_EMPTY)
+			&& !is_square_attacked(f1, false) && !is_square_attacked(g1, false))
+			move_list.push_back(encode_move(e1, g1, KING_CASTLE));
+		if ((m_castling_rights & WHITE_QUEEN_SIDE) && king_square == e1 && get_bit(own_rooks, a1) && !(occupied & WHITE_QUEEN_CASTLING_EMPTY)
+			&& !is_square_attacked(d1, false) && !is_square_attacked(c1, false))
+			move_list.push_back(encode_move(e1, c1, QUEEN_CASTLE));
+	}
+	else {
+		if ((m_castling_rights & BLACK_KING_SIDE) && king_square == e8 && get_bit(own_rooks, h8) && !(occupied & BLACK_KING_CASTLING_EMPTY)
+			&& !is_square_attacked(f8, true) && !is_square_attacked(g8, true))
+			move_list.push_back(encode_move(e8, g8, KING_CASTLE));
+		if ((m_castling_rights & BLACK_QUEEN_SIDE) && king_square == e8 && get_bit(own_rooks, a8) && !(occupied & BLACK_QUEEN_CASTLING_EMPTY)
+			&& !is_square_attacked(d8, true) && !is_square_attacked(c8, true))
+			move_list.push_back(encode_move(e8, c8, QUEEN_CASTLE));
+	}
+}
+
+// This function adds the pawn moves of the generation type that land on the target squares (en passant captures
+// aren't included). Directions and ranks of the color are compile-time constants.
+template <bool White, GenerationType Type>
+void Position::generate_pawn_moves_for(MoveList& move_list, U64 pawns, U64 targets) const {
+	constexpr int up = White ? ONE_SQUARE_UP : ONE_SQUARE_DOWN;
+	constexpr int west = White ? ONE_SQUARE_LEFT_ONE_UP : ONE_SQUARE_LEFT_ONE_DOWN;
+	constexpr int east = White ? ONE_SQUARE_RIGHT_ONE_UP : ONE_SQUARE_RIGHT_ONE_DOWN;
+	constexpr U64 promotion_rank = White ? RANK_7 : RANK_2;
+	constexpr U64 double_push_rank = White ? RANK_2 << 8 : RANK_7 >> 8;
+	U64 empty = ~(all_pieces);
+	U64 promoting_pawns = pawns & promotion_rank;
+	U64 other_pawns = pawns & ~promotion_rank;
+
+	if constexpr (Type != GENERATE_CAPTURES) {
+		U64 single_pushes = pawn_pushes(other_pawns, White) & empty;
+		U64 double_pushes = pawn_pushes(single_pushes & double_push_rank, White) & empty & targets;
+		add_pawn_moves(move_list, single_pushes & targets, up, QUIET);
+		add_pawn_moves(move_list, double_pushes, up + up, DOUBLE_PAWN_PUSH);
+	}
+	// Promotions count as captures, they change the material as well.
+	if constexpr (Type != GENERATE_QUIETS) {
+		U64 capture_targets = (White ? m_black_pieces : m_white_pieces) & targets;
+		add_pawn_moves(move_list, pawn_west_captures(other_pawns, White) & capture_targets, west, CAPTURE);
+		add_pawn_moves(move_list, pawn_east_captures(other_pawns, White) & capture_targets, east, CAPTURE);
+		if (promoting_pawns) {
+			add_promotions(move_list, pawn_pushes(promoting_pawns, White) & empty & targets, up, false);
+			add_promotions(move_list, pawn_west_captures(promoting_pawns, White) & capture_targets, west, true);
+			add_promotions(move_list, pawn_east_captures(promoting_pawns, White) & capture_targets, east, true);
+		}
+	}
+}
+
+// This function writes the legal moves of the generation type into the move list, for the side to move given at
+// compile time. In check only the king moves or the checker is captured or blocked, and pinned pieces only move along
+// the pin.
+template <bool White, GenerationType Type>
+void Position::generate_legal_moves_for(MoveList& move_list) const {
+	U64 own_pieces = White ? m_white_pieces : m_black_pieces;
+	U64 opponent_pieces = White ? m_black_pieces : m_white_pieces;
+	U64 occupied = all_pieces;
+	// Squares the moves of the generation type can go to (before the check and pin masks).
+	U64 type_targets = Type == GENERATE_ALL ? ~own_pieces : Type == GENERATE_CAPTURES ? opponent_pieces : ~occupied;
+	int king_square = get_king_square(White);
+	U64 checkers = attackers_to(king_square, occupied) & opponent_pieces;
+
+	// The king can't go to an attacked square. It's removed from the board for the test, otherwise it would hide the
+	// squares behind it on the line of a checking slider.
+	U64 occupied_without_king = occupied & ~(1ULL << king_square);
+	U64 king_targets = KING_ATTACKS[king_square] & type_targets;
+	while (king_targets) {
+		int move_to = std::countr_zero(king_targets);
+		king_targets &= king_targets - 1;
+		if (!(attackers_to(move_to, occupied_without_king) & opponent_pieces))
+			move_list.push_back(encode_move(king_square, move_to, get_bit(opponent_pieces, move_to) ? CAPTURE : QUIET));
+	}
+	// In double check only the king can move.
+	if (checkers & (checkers - 1)) return;
+
+	// In check the other pieces have to capture the checker or block the check. Pinned pieces can only move along the
+	// line of the pin (so never out of a check).
+	U64 check_mask = checkers ? squares_between[king_square][std::countr_zero(checkers)] | checkers : ~EMPTY_BITBOARD;
+	U64 targets = type_targets & check_mask;
+	U64 pinned = get_pinned_pieces();
+
+	U64 pawns = m_all_pieces_bitboards[PAWN] & own_pieces;
+	// Pawn pushes go to empty squares and captures to the opponent's pieces whatever the generation type, so the pawn
+	// targets only hold the check mask.
+	generate_pawn_moves_for<White, Type>(move_list, pawns & ~pinned, check_mask);
+	if (!checkers) {
+		U64 pinned_pawns = pawns & pinned;
+		while (pinned_pawns) {
+			int move_from = std::countr_zero(pinned_pawns);
+			pinned_pawns &= pinned_pawns - 1;
+			generate_pawn_moves_for<White, Type>(move_list, 1ULL << move_from, line_through[king_square][move_from]);
+		}
+	}
+
+	// En passant is rare, and it can uncover a check along the rank of both pawns, so it's checked with is_legal.
+	if constexpr (Type != GENERATE_QUIETS) {
+		int en_passant_square = m_en_passant_square;
+		if (en_passant_square >= 0) {
+			U64 en_passant_pawns = PAWN_ATTACKS[!White][en_passant_square] & pawns;
+			while (en_passant_pawns) {
+				Move move = encode_move(std::countr_zero(en_passant_pawns), en_passant_square, EN_PASSANT);
+				en_passant_pawns &= en_passant_pawns - 1;
+				if (is_legal(move))
+					move_list.push_back(move);
+			}
+		}
+	}
+
+	// Knights. A pinned knight can never move.
+	U64 knights = m_all_pieces_bitboards[KNIGHT] & own_pieces & ~pinned;
+	while (knights) {
+		int move_from = std::countr_zero(knights);
+		knights &= knights - 1;
+		add_moves(move_list, move_from, KNIGHT_ATTACKS[move_from] & targets, opponent_pieces);
+	}
+
+	// Bishops and queens along the diagonals.
+	U64 diagonal_sliders = (m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN]) & own_pieces;
+	while (diagonal_sliders) {
+		int move_from = std::countr_zero(diagonal_sliders);
+		diagonal_sliders &= diagonal_sliders - 1;
+		U64 pin_mask = get_bit(pinned, move_from) ? line_through[king_square][move_from] : ~EMPTY_BITBOARD;
+		add_moves(move_list, move_from, bishop_attacks(move_from, occupied) & targets & pin_mask, opponent_pieces);
+	}
+
+	// Rooks and queens along the ranks and files.
+	U64 straight_sliders = (m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN]) & own_pieces;
+	while (straight_sliders) {
+		int move_from = std::countr_zero(straight_sliders);
+		straight_sliders &= straight_sliders - 1;
+		U64 pin_mask = get_bit(pinned, move_from) ? line_through[king_square][move_from] : ~EMPTY_BITBOARD;
+		add_moves(move_list, move_from, rook_attacks(move_from, occupied) & targets & pin_mask, opponent_pieces);
+	}
+
+	// Castling is a quiet move. The king can't castle out of, through or into check, and the squares between the king
+	// and the rook have to be empty.
+	if constexpr (Type != GENERATE_CAPTURES) {
+		constexpr int king_start = White ? e1 : e8;
+		constexpr std::uint8_t king_side = White ? WHITE_KING_SIDE : BLACK_KING_SIDE;
+		constexpr std::uint8_t queen_side = White ? WHITE_QUEEN_SIDE : BLACK_QUEEN_SIDE;
+		constexpr U64 king_side_empty = White ? WHITE_KING_CASTLING_EMPTY : BLACK_KING_CASTLING_EMPTY;
+		constexpr U64 queen_side_empty = White ? WHITE_QUEEN_CASTLING_EMPTY : BLACK_QUEEN_CASTLING_EMPTY;
+		constexpr int king_side_rook = king_start + 3;
+		constexpr int queen_side_rook = king_start - 4;
+		if (checkers || king_square != king_start) return;
+		U64 own_rooks = m_all_pieces_bitboards[ROOK] & own_pieces;
+		if ((m_castling_rights & king_side) && get_bit(own_rooks, king_side_rook) && !(occupied & king_side_empty)
+			&& !is_square_attacked(king_start + 1, !White) && !is_square_attacked(king_start + 2, !White))
+			move_list.push_back(encode_move(king_start, king_start + 2, KING_CASTLE));
+		if ((m_castling_rights & queen_side) && get_bit(own_rooks, queen_side_rook) && !(occupied & queen_side_empty)
+			&& !is_square_attacked(king_start - 1, !White) && !is_square_attacked(king_start - 2, !White))
+			move_list.push_back(encode_move(king_start, king_start - 2, QUEEN_CASTLE));
+	}
+}
+
+// This function writes all legal moves of the side to move into the move list. The moves are generated legal: in
+// check only the king moves or the checker is captured or blocked, and pinned pieces only move along the pin.
+void Position::generate_legal_moves(MoveList& move_list) const {
+	if (m_active_color) generate_legal_moves_for<true, GENERATE_ALL>(move_list);
+	else generate_legal_moves_for<false, GENERATE_ALL>(move_list);
+}
+
+// This function writes the legal captures and promotions of the side to move into the move list.
+void Position::generate_legal_captures(MoveList& move_list) const {
+	if (m_active_color) generate_legal_moves_for<true, GENERATE_CAPTURES>(move_list);
+	else generate_legal_moves_for<false, GENERATE_CAPTURES>(move_list);
+}
+
+// This function writes the legal quiet moves (no captures or promotions) of the side to move into the move list.
+void Position::generate_legal_quiets(MoveList& move_list) const {
+	if (m_active_color) generate_legal_moves_for<true, GENERATE_QUIETS>(move_list);
+	else generate_legal_moves_for<false, GENERATE_QUIETS>(move_list);
+}
@@ -0,0 +1,169 @@
+#include <cstdlib>
+#include <utility>
+#include "evaluate.h"
+#include "movepick.h"
+
+// This function clears all tables (before a new game).
+void SearchHistory::clear() {
+	for (auto& color_history : butterfly)
+		for (auto& from_history : color_history)
+			from_history.fill(0);
+	for (auto& previous_piece_history : continuation)
+		for (auto& previous_to_history : previous_piece_history)
+			for (auto& piece_history : previous_to_history)
+				piece_history.fill(0);
+	for (auto& piece_counter_moves : counter_moves)
+		piece_counter_moves.fill(NO_MOVE);
+}
+
+// This function adds the bonus (negative for a penalty) to the history score. The more the score already points the
+// same way, the less it changes, so it never leaves the HISTORY_MAX limits.
+void SearchHistory::update(std::int16_t& score, int bonus) {
+	score = static_cast<std::int16_t>(score + bonus - score * std::abs(bonus) / HISTORY_MAX);
+}
+
+// Picker of the main search. The hash move, the killers and the counter move may be NO_MOVE or moves that aren't legal
+// here.
+MovePicker::MovePicker(const Position& position, const SearchHistory& history, Move hash_move, Move killer_1,
+	Move killer_2, Move counter_move, int previous_piece, int previous_to)
+	: m_position{ position }
+	, m_history{ history }
+	, m_stage{ HASH_MOVE }
+	, m_hash_move{ hash_move }
+	, m_refutations{ killer_1, killer_2, counter_move }
+	, m_previous_piece{ previous_piece }
+	, m_previous_to{ previous_to }
+	, m_skip_quiets{}
+{
+	// Refutations are quiet moves, so they can't be captures of the capture stages, but they may repeat each other or
+	// the hash move.
+	for (std::size_t i = 0; i < m_refutations.size(); ++i) {
+		Move& move = m_refutations[i];
+		if (move == m_hash_move || is_capture(move) || is_promotion(move)) move = NO_MOVE;
+		for (std::size_t j = 0; j < i; ++j)
+			if (move == m_refutations[j]) move = NO_MOVE;
+	}
+	if (m_hash_move != NO_MOVE && !(position.is_pseudo_legal(m_hash_move) && position.is_legal(m_hash_move)))
+		m_hash_move = NO_MOVE;
+}
+
+// Picker of the quiescence search: captures and promotions that don't lose material, all moves when in check.
+MovePicker::MovePicker(const Position& position, const SearchHistory& history, bool in_check)
+	: m_position{ position }
+	, m_history{ history }
+	, m_stage{ GENERATE_CAPTURES }
+	, m_hash_move{ NO_MOVE }
+	, m_refutations{ NO_MOVE, NO_MOVE, NO_MOVE }
+	, m_previous_piece{ NO_PIECE }
+	, m_previous_to{ a1 }
+	, m_skip_quiets{ !in_check }
+{
+}
+
+// This function scores the captures and promotions by the most valuable victim, least valuable attacker order.
+void MovePicker::score_captures() {
+	for (std::size_t i = 0; i < m_moves.size(); ++i) {
+		Move move = m_moves[i];
+		int victim = move_flags(move) == EN_PASSANT ? PAWN : type_of_piece(m_position.piece_on(to_square(move)));
+		int victim_value = is_capture(move) ? PIECE_VALUES[static_cast<std::size_t>(victim)] : 0;
+		int promotion_value = is_promotion(move) ? PIECE_VALUES[static_cast<std::size_t>(promotion_piece(move))] : 0;
+		int attacker = type_of_piece(m_position.piece_on(from_square(move)));
+		m_scores[i] = (victim_value + promotion_value) * 8 - attacker;
+	}
+}
+
+// This function scores the quiet moves by their history.
+void MovePicker::score_quiets() {
+	const auto& butterfly = m_history.butterfly[m_position.get_active_color()];
+	const auto& continuation = m_history.continuation[static_cast<std::size_t>(m_previous_piece)]
+		[static_cast<std::size_t>(m_previous_to)];
+	for (std::size_t i = 0; i < m_moves.size(); ++i) {
+		Move move = m_moves[i];
+		std::size_t move_from = static_cast<std::size_t>(from_square(move));
+		std::size_t move_to = static_cast<std::size_t>(to_square(move));
+		std::size_t piece = static_cast<std::size_t>(m_position.piece_on(from_square(move)));
+		m_scores[i] = butterfly[move_from][move_to] + continuation[piece][move_to];
+	}
+}
+
+// This function returns the best scored of the remaining moves of the stage (selection sort, one step at a time, so
+// moves after a cutoff are never sorted). Returns NO_MOVE when all of them have been returned.
+Move MovePicker::pick_best() {
+	if (m_current >= m_moves.size()) return NO_MOVE;
+	std::size_t best = m_current;
+	for (std::size_t i = m_current + 1; i < m_moves.size(); ++i)
+		if (m_scores[i] > m_scores[best]) best = i;
+	std::swap(m_moves.moves[m_current], m_moves.moves[best]);
+	std::swap(m_scores[m_current], m_scores[best]);
+	return m_moves[m_current++];
+}
+
+// This function returns true if the move was already returned by an earlier stage.
+bool MovePicker::is_duplicate(Move move) const {
+	if (move == m_hash_move) return true;
+	for (std::size_t i = 0; i < m_refutation_index; ++i)
+		if (move == m_refutations[i]) return true;
+	return false;
+}
+
+// This function returns the next move (NO_MOVE when there are no moves left). All returned moves are legal.
+Move MovePicker::next_move() {
+	switch (m_stage) {
+	case HASH_MOVE:
+		m_stage = GENERATE_CAPTURES;
+		if (m_hash_move != NO_MOVE) return m_hash_move;
+		[[fallthrough]];
+
+	case GENERATE_CAPTURES:
+		m_position.generate_legal_captures(m_moves);
+		score_captures();
+		m_current = 0;
+		m_stage = GOOD_CAPTURES;
+		[[fallthrough]];
+
+	case GOOD_CAPTURES:
+		for (Move move = pick_best(); move != NO_MOVE; move = pick_best()) {
+			if (move == m_hash_move) continue;
+			if (m_position.see(move, 0)) return move;
+			// The quiescence search drops the losing captures.
+			if (!m_skip_quiets) m_bad_captures.push_back(move);
+		}
+		if (m_skip_quiets) {
+			m_stage = DONE;
+			return NO_MOVE;
+		}
+		m_stage = REFUTATIONS;
+		[[fallthrough]];
+
+	case REFUTATIONS:
+		while (m_refutation_index < m_refutations.size()) {
+			Move move = m_refutations[m_refutation_index++];
+			if (move != NO_MOVE && m_position.is_pseudo_legal(move) && m_position.is_legal(move)) return move;
+		}
+		m_stage = GENERATE_QUIETS;
+		[[fallthrough]];
+
+	case GENERATE_QUIETS:
+		m_moves.count = 0;
+		m_position.generate_legal_quiets(m_moves);
+		score_quiets();
+		m_current = 0;
+		m_stage = QUIETS;
+		[[fallthrough]];
+
+	case QUIETS:
+		for (Move move = pick_best(); move != NO_MOVE; move = pick_best())
+			if (!is_duplicate(move)) return move;
+		m_stage = BAD_CAPTURES;
+		[[fallthrough]];
+
+	case BAD_CAPTURES:
+		if (m_bad_current < m_bad_captures.size()) return m_bad_captures[m_bad_current++];
+		m_stage = DONE;
+		[[fallthrough]];
+
+	case DONE:
+		return NO_MOVE;
+	}
+	return NO_MOVE;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "move.h"
+#include "position.h"
+
+// History scores stay within -HISTORY_MAX and HISTORY_MAX.
+constexpr int HISTORY_MAX{ 16384 };
+
+// What the search has learned about quiet moves, used to order them. Pieces are mailbox pieces (piece type and color
+// bit), so the tables have 16 piece entries. The previous move of a position without one is NO_PIECE on a1.
+struct SearchHistory {
+	// Butterfly history: how often the move of the color (0 - black, 1 - white) from the square to the square caused a
+	// beta cutoff, indexed by color, "move from" and "move to".
+	std::array<std::array<std::array<std::int16_t, 64>, 64>, 2> butterfly{};
+	// Continuation history: the same for the piece moving to the square right after the previous move, indexed by the
+	// piece and "move to" square of the previous move, then of the move.
+	std::array<std::array<std::array<std::array<std::int16_t, 64>, 16>, 64>, 16> continuation{};
+	// Counter moves: the quiet move that last refuted the previous move, indexed by its piece and "move to" square.
+	std::array<std::array<Move, 64>, 16> counter_moves{};
+
+	// This function clears all tables (before a new game).
+	void clear();
+
+	// This function adds the bonus (negative for a penalty) to the history score. The more the score already points
+	// the same way, the less it changes, so it never leaves the HISTORY_MAX limits.
+	static void update(std::int16_t& score, int bonus);
+};
+
+// Staged move picker. It returns the legal moves of the position one at a time in the order they are likely to be
+// best and generates them only when it gets to them, so a cutoff by the hash move generates no moves at all and a
+// cutoff by a capture or a killer generates no quiet moves. The stages:
+//   1. the hash move (only checked for legality),
+//   2. the captures and promotions that don't lose material by the static exchange evaluation, most valuable victim
+//      and least valuable attacker first,
+//   3. the two killer moves and the counter move of the previous move (quiet moves checked for legality),
+//   4. the other quiet moves, ordered by their butterfly and continuation history,
+//   5. the losing captures.
+// The quiescence search gets only the captures and promotions that don't lose material (all moves when in check),
+// without the hash move and the killers.
+class MovePicker {
+	enum Stage {
+		HASH_MOVE, GENERATE_CAPTURES, GOOD_CAPTURES, REFUTATIONS, GENERATE_QUIETS, QUIETS, BAD_CAPTURES, DONE
+	};
+
+	const Position& m_position;
+	const SearchHistory& m_history;
+	Stage m_stage;
+	Move m_hash_move;
+	// Killer moves and the counter move (NO_MOVE if there is none or it's a duplicate).
+	std::array<Move, 3> m_refutations;
+	std::size_t m_refutation_index{};
+	// Piece and "move to" square of the previous move, for the continuation history.
+	int m_previous_piece;
+	int m_previous_to;
+	// Out of check the quiescence search doesn't search quiet moves and losing captures.
+	bool m_skip_quiets;
+
+	// Moves of the current stage with their ordering scores; only the first m_current ones have been returned.
+	MoveList m_moves;
+	std::array<int, MoveList::CAPACITY> m_scores;
+	std::size_t m_current{};
+	// Losing captures, put aside for the last stage in the order they were found.
+	MoveList m_bad_captures;
+	std::size_t m_bad_current{};
+
+	// This function scores the captures and promotions by the most valuable victim, least valuable attacker order.
+	void score_captures();
+
+	// This function scores the quiet moves by their history.
+	void score_quiets();
+
+	// This function returns the best scored of the remaining moves of the stage (selection sort, one step at a time,
+	// so moves after a cutoff are never sorted). Returns NO_MOVE when all of them have been returned.
+	Move pick_best();
+
+	// This function returns true if the move was already returned by an earlier stage.
+	bool is_duplicate(Move move) const;
+
+public:
+	// Picker of the main search. The hash move, the killers and the counter move may be NO_MOVE or moves that aren't
+	// legal here.
+	MovePicker(const Position& position, const SearchHistory& history, Move hash_move, Move killer_1, Move killer_2,
+		Move counter_move, int previous_piece, int previous_to);
+
+	// Picker of the quiescence search: captures and promotions that don't lose material, all moves when in check.
+	MovePicker(const Position& position, const SearchHistory& history, bool in_check);
+
+	// This function returns the next move (NO_MOVE when there are no moves left). All returned moves are legal.
+	Move next_move();
+};
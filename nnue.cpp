@@ -0,0 +1,637 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "evaluate.h"
+#include "mapped_file.h"
+#include "nnue.h"
+#include "perft.h"
+
+// The SIMD kernels can only be used on x86-64. GCC and Clang only compile the intrinsics inside functions built for
+// their instruction set, so the kernels are built for it even when the rest of the engine isn't. They're only called
+// when the CPU supports it.
+#if (defined(_MSC_VER) && defined(_M_X64)) || ((defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__))
+#include <immintrin.h>
+#define NNUE_SIMD_AVAILABLE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Network file: a header of NETWORK_HEADER_BYTES, then the parameters in little endian, every section starting at a
+// multiple of NETWORK_ALIGNMENT bytes (so the mapped weights are aligned for the vector loads):
+// - feature transformer biases (int16, NNUE_HALF_DIMENSIONS) and weights (int16, a row of NNUE_HALF_DIMENSIONS for
+//   every feature),
+// - first hidden layer biases (int32, NNUE_HIDDEN_1) and weights (int8, a row of 2 * NNUE_HALF_DIMENSIONS for every
+//   output),
+// - second hidden layer biases (int32, NNUE_HIDDEN_2) and weights (int8, a row of NNUE_HIDDEN_1 for every output),
+// - output bias (int32) and weights (int8, NNUE_HIDDEN_2).
+// The header is the magic followed by uint32 fields: the version, the four layer sizes (which have to match the
+// architecture) and the output scale (the output divided by it is the evaluation in centipawns).
+static constexpr std::array<char, 4> NETWORK_MAGIC{ 'N', 'N', 'U', 'E' };
+static constexpr std::uint32_t NETWORK_VERSION{ 1 };
+static constexpr std::size_t NETWORK_HEADER_FIELDS{ 6 };
+static constexpr std::size_t NETWORK_HEADER_BYTES{ 64 };
+static constexpr std::size_t NETWORK_ALIGNMENT{ 64 };
+
+// Fixed point arithmetic: the transformed features and the hidden layer outputs are clipped to 0 - ACTIVATION_MAX,
+// and the dense layer sums are shifted right by WEIGHT_SCALE_BITS before that.
+static constexpr int ACTIVATION_MAX{ 127 };
+static constexpr int WEIGHT_SCALE_BITS{ 6 };
+
+// The evaluation of the network is limited to this, well below the mate scores.
+static constexpr int MAX_NETWORK_EVALUATION{ 10000 };
+
+// Offsets of the sections in the network file and its size.
+struct NetworkLayout {
+	std::size_t transformer_biases;
+	std::size_t transformer_weights;
+	std::size_t hidden1_biases;
+	std::size_t hidden1_weights;
+	std::size_t hidden2_biases;
+	std::size_t hidden2_weights;
+	std::size_t output_bias;
+	std::size_t output_weights;
+	std::size_t size;
+};
+
+static constexpr NetworkLayout NETWORK_LAYOUT = [] {
+	NetworkLayout layout{};
+	std::size_t offset{ NETWORK_HEADER_BYTES };
+	auto section = [&offset](std::size_t bytes) {
+		std::size_t start = offset;
+		offset = (offset + bytes + NETWORK_ALIGNMENT - 1) / NETWORK_ALIGNMENT * NETWORK_ALIGNMENT;
+		return start;
+	};
+	layout.transformer_biases = section(NNUE_HALF_DIMENSIONS * sizeof(std::int16_t));
+	layout.transformer_weights = section(NNUE_FEATURES * NNUE_HALF_DIMENSIONS * sizeof(std::int16_t));
+	layout.hidden1_biases = section(NNUE_HIDDEN_1 * sizeof(std::int32_t));
+	layout.hidden1_weights = section(NNUE_HIDDEN_1 * 2 * NNUE_HALF_DIMENSIONS);
+	layout.hidden2_biases = section(NNUE_HIDDEN_2 * sizeof(std::int32_t));
+	layout.hidden2_weights = section(NNUE_HIDDEN_2 * NNUE_HIDDEN_1);
+	layout.output_bias = section(sizeof(std::int32_t));
+	layout.output_weights = section(NNUE_HIDDEN_2);
+	layout.size = offset;
+	return layout;
+}();
+
+// Parameters of the loaded network. They point into the mapped file (or the memory of the benchmark's random network).
+struct Network {
+	const std::int16_t* transformer_biases;
+	const std::int16_t* transformer_weights;
+	const std::int32_t* hidden1_biases;
+	const std::int8_t* hidden1_weights;
+	const std::int32_t* hidden2_biases;
+	const std::int8_t* hidden2_weights;
+	const std::int32_t* output_bias;
+	const std::int8_t* output_weights;
+	int output_scale;
+};
+
+static Network network{};
+static bool network_is_loaded{};
+static std::unique_ptr<MappedFile> network_file{};
+static std::vector<char> network_memory{};
+static std::string network_name{};
+
+// Kernels of one instruction set. The sizes have to be multiples of 32.
+struct Kernels {
+	// Writes input plus the added rows minus the removed rows (NNUE_HALF_DIMENSIONS values) into output.
+	void (*update)(std::int16_t* output, const std::int16_t* input, const std::int16_t* const* added,
+		std::size_t added_count, const std::int16_t* const* removed, std::size_t removed_count);
+	// Clips the values to 0 - ACTIVATION_MAX.
+	void (*activate)(const std::int16_t* input, std::uint8_t* output, std::size_t count);
+	// Dense layer: every output is its bias plus the input multiplied by its row of the weights.
+	void (*affine)(const std::uint8_t* input, std::size_t input_size, const std::int8_t* weights,
+		const std::int32_t* biases, std::int32_t* output, std::size_t output_size);
+};
+
+static void update_scalar(std::int16_t* output, const std::int16_t* input, const std::int16_t* const* added,
+	std::size_t added_count, const std::int16_t* const* removed, std::size_t removed_count) {
+	for (std::size_t i = 0; i < NNUE_HALF_DIMENSIONS; ++i) {
+		int value = input[i];
+		for (std::size_t row = 0; row < added_count; ++row)
+			value += added[row][i];
+		for (std::size_t row = 0; row < removed_count; ++row)
+			value -= removed[row][i];
+		// Wraps around like the 16-bit vector additions.
+		output[i] = static_cast<std::int16_t>(value);
+	}
+}
+
+static void activate_scalar(const std::int16_t* input, std::uint8_t* output, std::size_t count) {
+	for (std::size_t i = 0; i < count; ++i)
+		output[i] = static_cast<std::uint8_t>(std::clamp<int>(input[i], 0, ACTIVATION_MAX));
+}
+
+static void affine_scalar(const std::uint8_t* input, std::size_t input_size, const std::int8_t* weights,
+	const std::int32_t* biases, std::int32_t* output, std::size_t output_size) {
+	for (std::size_t i = 0; i < output_size; ++i) {
+		const std::int8_t* row = weights + i * input_size;
+		std::int32_t sum = biases[i];
+		for (std::size_t j = 0; j < input_size; ++j)
+			sum += input[j] * row[j];
+		output[i] = sum;
+	}
+}
+
+#if defined(NNUE_SIMD_AVAILABLE)
+TARGET_SSE41 static void update_sse41(std::int16_t* output, const std::int16_t* input, const std::int16_t* const* added,
+	std::size_t added_count, const std::int16_t* const* removed, std::size_t removed_count) {
+	for (std::size_t i = 0; i < NNUE_HALF_DIMENSIONS; i += 8) {
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		for (std::size_t row = 0; row < added_count; ++row)
+			value = _mm_add_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(added[row] + i)));
+		for (std::size_t row = 0; row < removed_count; ++row)
+			value = _mm_sub_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(removed[row] + i)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), value);
+	}
+}
+
+TARGET_SSE41 static void activate_sse41(const std::int16_t* input, std::uint8_t* output, std::size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	for (std::size_t i = 0; i < count; i += 16) {
+		__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+		// Packing saturates to -128 - 127, the maximum with zero clips the negative values.
+		__m128i packed = _mm_max_epi8(_mm_packs_epi16(low, high), zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), packed);
+	}
+}
+
+TARGET_SSE41 static void affine_sse41(const std::uint8_t* input, std::size_t input_size, const std::int8_t* weights,
+	const std::int32_t* biases, std::int32_t* output, std::size_t output_size) {
+	const __m128i ones = _mm_set1_epi16(1);
+	for (std::size_t i = 0; i < output_size; ++i) {
+		const std::int8_t* row = weights + i * input_size;
+		__m128i sum = _mm_setzero_si128();
+		for (std::size_t j = 0; j < input_size; j += 16) {
+			// Pairs of unsigned inputs times signed weights into 16 bits (the activations are at most 127, so the
+			// pair sums don't saturate), then pairs of those into 32 bits.
+			__m128i products = _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + j)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j)));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+		}
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+		output[i] = biases[i] + _mm_cvtsi128_si32(sum);
+	}
+}
+
+TARGET_AVX2 static void update_avx2(std::int16_t* output, const std::int16_t* input, const std::int16_t* const* added,
+	std::size_t added_count, const std::int16_t* const* removed, std::size_t removed_count) {
+	for (std::size_t i = 0; i < NNUE_HALF_DIMENSIONS; i += 16) {
+		__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+		for (std::size_t row = 0; row < added_count; ++row)
+			value = _mm256_add_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(added[row] + i)));
+		for (std::size_t row = 0; row < removed_count; ++row)
+			value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(removed[row] + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), value);
+	}
+}
+
+TARGET_AVX2 static void activate_avx2(const std::int16_t* input, std::uint8_t* output, std::size_t count) {
+	const __m256i zero = _mm256_setzero_si256();
+	for (std::size_t i = 0; i < count; i += 32) {
+		__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+		__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16));
+		// Packing works within the 128-bit lanes, the permutation puts the quarters back in order.
+		__m256i packed = _mm256_max_epi8(_mm256_packs_epi16(low, high), zero);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+}
+
+TARGET_AVX2 static void affine_avx2(const std::uint8_t* input, std::size_t input_size, const std::int8_t* weights,
+	const std::int32_t* biases, std::int32_t* output, std::size_t output_size) {
+	const __m256i ones = _mm256_set1_epi16(1);
+	for (std::size_t i = 0; i < output_size; ++i) {
+		const std::int8_t* row = weights + i * input_size;
+		__m256i sum = _mm256_setzero_si256();
+		for (std::size_t j = 0; j < input_size; j += 32) {
+			__m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + j)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j)));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+		}
+		__m128i half_sum = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		half_sum = _mm_add_epi32(half_sum, _mm_shuffle_epi32(half_sum, 0x4E));
+		half_sum = _mm_add_epi32(half_sum, _mm_shuffle_epi32(half_sum, 0xB1));
+		output[i] = biases[i] + _mm_cvtsi128_si32(half_sum);
+	}
+}
+#endif
+
+// Kernels indexed by the instruction set. Without x86-64 all of them are the scalar ones.
+#if defined(NNUE_SIMD_AVAILABLE)
+static constexpr std::array<Kernels, 3> KERNELS{ {
+	{ update_scalar, activate_scalar, affine_scalar },
+	{ update_sse41, activate_sse41, affine_sse41 },
+	{ update_avx2, activate_avx2, affine_avx2 }
+} };
+#else
+static constexpr std::array<Kernels, 3> KERNELS{ {
+	{ update_scalar, activate_scalar, affine_scalar },
+	{ update_scalar, activate_scalar, affine_scalar },
+	{ update_scalar, activate_scalar, affine_scalar }
+} };
+#endif
+
+static constexpr std::array<const char*, 3> SIMD_LEVEL_NAMES{ "scalar", "SSE4.1", "AVX2" };
+
+// This function returns the best instruction set of the kernels that the CPU supports.
+SimdLevel best_simd_level() {
+#if defined(_MSC_VER) && defined(_M_X64)
+	int registers[4]{};
+	__cpuid(registers, 1);
+	bool sse41 = (registers[2] >> 19) & 1;
+	// AVX2 also needs the system to save the AVX registers (OSXSAVE, AVX and both bits in XCR0).
+	bool avx_enabled = ((registers[2] >> 27) & 1) && ((registers[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(registers, 7, 0);
+	bool avx2 = avx_enabled && ((registers[1] >> 5) & 1);
+#elif defined(NNUE_SIMD_AVAILABLE)
+	__builtin_cpu_init();
+	bool sse41 = __builtin_cpu_supports("sse4.1");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#else
+	bool sse41{};
+	bool avx2{};
+#endif
+	return avx2 ? SIMD_AVX2 : sse41 ? SIMD_SSE41 : SIMD_SCALAR;
+}
+
+static SimdLevel simd_level{ best_simd_level() };
+static const Kernels* kernels{ &KERNELS[simd_level] };
+
+// This function sets the instruction set of the kernels (limited to what the CPU supports) and returns the one set.
+SimdLevel set_simd_level(SimdLevel level) {
+	simd_level = std::min(level, best_simd_level());
+	kernels = &KERNELS[simd_level];
+	return simd_level;
+}
+
+// This function returns the HalfKP feature of the piece on the square for the perspective with its king on the king
+// square. Black's perspective sees the board flipped vertically, and every perspective sees its own pieces first.
+static std::size_t feature_index(bool perspective, int king_square, int piece, int square) {
+	int flip = perspective ? 0 : 56;
+	int kind = type_of_piece(piece) * 2 + (is_white_piece(piece) == perspective ? 0 : 1);
+	return static_cast<std::size_t>((king_square ^ flip) * static_cast<int>(NNUE_PIECE_SQUARES) + 1 + kind * 64
+		+ (square ^ flip));
+}
+
+// This function returns the transformer weights of the feature.
+static const std::int16_t* feature_weights(std::size_t feature) {
+	return network.transformer_weights + feature * NNUE_HALF_DIMENSIONS;
+}
+
+// This function computes the perspective's half of the accumulator from scratch.
+static void refresh_perspective(const Position& position, bool perspective, Accumulator& accumulator) {
+	std::size_t side = static_cast<std::size_t>(perspective);
+	std::array<const std::int16_t*, 64> rows;
+	std::size_t row_count{};
+	int king_square = position.get_king_square(perspective);
+	U64 pieces = position.get_occupied() & ~position.get_pieces(KING);
+	while (pieces) {
+		int square = std::countr_zero(pieces);
+		pieces &= pieces - 1;
+		rows[row_count++] = feature_weights(feature_index(perspective, king_square, position.piece_on(square), square));
+	}
+	kernels->update(accumulator.values[side].data(), network.transformer_biases, rows.data(), row_count, nullptr, 0);
+	accumulator.computed[side] = true;
+}
+
+// This function computes the perspective's half of the accumulator from the parent's by the pieces the move changed.
+// The king of the perspective must not have moved.
+static void update_perspective(const DirtyPieces& dirty_pieces, bool perspective, int king_square,
+	const Accumulator& parent, Accumulator& accumulator) {
+	std::size_t side = static_cast<std::size_t>(perspective);
+	std::array<const std::int16_t*, 3> added;
+	std::array<const std::int16_t*, 3> removed;
+	std::size_t added_count{};
+	std::size_t removed_count{};
+	for (std::size_t i = 0; i < dirty_pieces.count; ++i) {
+		if (dirty_pieces.from[i] != DirtyPieces::NO_CHANGE_SQUARE)
+			removed[removed_count++] = feature_weights(feature_index(perspective, king_square, dirty_pieces.piece[i],
+				dirty_pieces.from[i]));
+		if (dirty_pieces.to[i] != DirtyPieces::NO_CHANGE_SQUARE)
+			added[added_count++] = feature_weights(feature_index(perspective, king_square, dirty_pieces.piece[i],
+				dirty_pieces.to[i]));
+	}
+	kernels->update(accumulator.values[side].data(), parent.values[side].data(), added.data(), added_count,
+		removed.data(), removed_count);
+	accumulator.computed[side] = true;
+}
+
+// This function clips the dense layer sums into the activations of the next layer.
+static void clip_sums(const std::int32_t* sums, std::uint8_t* activations, std::size_t count) {
+	for (std::size_t i = 0; i < count; ++i)
+		activations[i] = static_cast<std::uint8_t>(std::clamp(sums[i] >> WEIGHT_SCALE_BITS, 0, ACTIVATION_MAX));
+}
+
+// This function runs the layers after the feature transformer and returns the evaluation for the side to move.
+static int propagate(const Accumulator& accumulator, bool white_to_move) {
+	alignas(64) std::array<std::uint8_t, 2 * NNUE_HALF_DIMENSIONS> transformed;
+	kernels->activate(accumulator.values[white_to_move].data(), transformed.data(), NNUE_HALF_DIMENSIONS);
+	kernels->activate(accumulator.values[!white_to_move].data(), transformed.data() + NNUE_HALF_DIMENSIONS,
+		NNUE_HALF_DIMENSIONS);
+	alignas(64) std::array<std::int32_t, NNUE_HIDDEN_1> hidden1_sums;
+	alignas(64) std::array<std::uint8_t, NNUE_HIDDEN_1> hidden1;
+	kernels->affine(transformed.data(), transformed.size(), network.hidden1_weights, network.hidden1_biases,
+		hidden1_sums.data(), NNUE_HIDDEN_1);
+	clip_sums(hidden1_sums.data(), hidden1.data(), NNUE_HIDDEN_1);
+	alignas(64) std::array<std::int32_t, NNUE_HIDDEN_2> hidden2_sums;
+	alignas(64) std::array<std::uint8_t, NNUE_HIDDEN_2> hidden2;
+	kernels->affine(hidden1.data(), NNUE_HIDDEN_1, network.hidden2_weights, network.hidden2_biases, hidden2_sums.data(),
+		NNUE_HIDDEN_2);
+	clip_sums(hidden2_sums.data(), hidden2.data(), NNUE_HIDDEN_2);
+	std::int32_t output{};
+	kernels->affine(hidden2.data(), NNUE_HIDDEN_2, network.output_weights, network.output_bias, &output, 1);
+	return std::clamp(output / network.output_scale, -MAX_NETWORK_EVALUATION, MAX_NETWORK_EVALUATION);
+}
+
+// This function allocates the accumulators for plies 0 to max_ply.
+AccumulatorStack::AccumulatorStack(int max_ply)
+	: m_accumulators(static_cast<std::size_t>(max_ply) + 1)
+	, m_dirty_pieces(static_cast<std::size_t>(max_ply) + 1)
+{
+}
+
+// This function sets the position at ply 0 and computes its accumulator.
+void AccumulatorStack::reset(const Position& position) {
+	refresh_perspective(position, false, m_accumulators[0]);
+	refresh_perspective(position, true, m_accumulators[0]);
+}
+
+// This function adds one changed piece to the move's dirty pieces.
+static void add_dirty_piece(DirtyPieces& dirty_pieces, int piece, int from, int to) {
+	std::size_t i = dirty_pieces.count++;
+	dirty_pieces.piece[i] = static_cast<std::uint8_t>(piece);
+	dirty_pieces.from[i] = static_cast<std::uint8_t>(from);
+	dirty_pieces.to[i] = static_cast<std::uint8_t>(to);
+}
+
+// This function records the move about to be made in the position at the ply.
+void AccumulatorStack::push_move(const Position& position, Move move, int ply) {
+	constexpr int NONE{ DirtyPieces::NO_CHANGE_SQUARE };
+	std::size_t child = static_cast<std::size_t>(ply) + 1;
+	DirtyPieces& dirty_pieces = m_dirty_pieces[child];
+	m_accumulators[child].computed = { false, false };
+	dirty_pieces.count = 0;
+	dirty_pieces.king_moved = { false, false };
+	bool white = position.get_active_color();
+	int move_from = from_square(move);
+	int move_to = to_square(move);
+	int piece = position.piece_on(move_from);
+	if (type_of_piece(piece) == KING)
+		dirty_pieces.king_moved[white] = true;
+	else
+		add_dirty_piece(dirty_pieces, piece, move_from, is_promotion(move) ? NONE : move_to);
+	if (is_promotion(move))
+		add_dirty_piece(dirty_pieces, make_piece(promotion_piece(move), white), NONE, move_to);
+	if (move_flags(move) == EN_PASSANT) {
+		int captured_square = move_to + (white ? -8 : 8);
+		add_dirty_piece(dirty_pieces, position.piece_on(captured_square), captured_square, NONE);
+	}
+	else if (is_capture(move))
+		add_dirty_piece(dirty_pieces, position.piece_on(move_to), move_to, NONE);
+	if (is_castling(move)) {
+		bool king_side = move_flags(move) == KING_CASTLE;
+		add_dirty_piece(dirty_pieces, make_piece(ROOK, white), king_side ? move_to + 1 : move_to - 2,
+			king_side ? move_to - 1 : move_to + 1);
+	}
+}
+
+// This function evaluates the position at the ply from the point of view of the side to move. Each half of the
+// accumulator is updated from the closest ancestor that has it computed, through the dirty pieces of the moves since.
+// A king move of the perspective on the way changes all its features, so the half is computed from scratch then.
+int AccumulatorStack::evaluate(const Position& position, int ply) {
+	std::size_t current = static_cast<std::size_t>(ply);
+	for (bool perspective : { false, true }) {
+		std::size_t side = static_cast<std::size_t>(perspective);
+		std::size_t start = current;
+		while (start > 0 && !m_accumulators[start].computed[side] && !m_dirty_pieces[start].king_moved[side])
+			--start;
+		if (!m_accumulators[start].computed[side]) {
+			refresh_perspective(position, perspective, m_accumulators[current]);
+			continue;
+		}
+		int king_square = position.get_king_square(perspective);
+		for (std::size_t i = start + 1; i <= current; ++i)
+			update_perspective(m_dirty_pieces[i], perspective, king_square, m_accumulators[i - 1], m_accumulators[i]);
+	}
+	return propagate(m_accumulators[current], position.get_active_color());
+}
+
+// This function checks the header and the size of the network file and points the parameters into its data.
+// Returns nullptr if it's a valid network, otherwise the description of the error.
+static const char* parse_network(std::string_view data, Network& parsed) {
+	if constexpr (std::endian::native != std::endian::little)
+		return "network files can only be used on little endian CPUs.";
+	if (data.size() < NETWORK_HEADER_BYTES || !std::equal(NETWORK_MAGIC.begin(), NETWORK_MAGIC.end(), data.begin()))
+		return "not a network file.";
+	std::array<std::uint32_t, NETWORK_HEADER_FIELDS> fields;
+	std::memcpy(fields.data(), data.data() + NETWORK_MAGIC.size(), sizeof(fields));
+	if (fields[0] != NETWORK_VERSION)
+		return "unsupported network version.";
+	if (fields[1] != NNUE_FEATURES || fields[2] != NNUE_HALF_DIMENSIONS || fields[3] != NNUE_HIDDEN_1
+		|| fields[4] != NNUE_HIDDEN_2)
+		return "the network has a different architecture.";
+	if (fields[5] == 0)
+		return "the output scale is zero.";
+	if (data.size() != NETWORK_LAYOUT.size)
+		return "the file size doesn't match the architecture.";
+	const char* base = data.data();
+	parsed.transformer_biases = reinterpret_cast<const std::int16_t*>(base + NETWORK_LAYOUT.transformer_biases);
+	parsed.transformer_weights = reinterpret_cast<const std::int16_t*>(base + NETWORK_LAYOUT.transformer_weights);
+	parsed.hidden1_biases = reinterpret_cast<const std::int32_t*>(base + NETWORK_LAYOUT.hidden1_biases);
+	parsed.hidden1_weights = reinterpret_cast<const std::int8_t*>(base + NETWORK_LAYOUT.hidden1_weights);
+	parsed.hidden2_biases = reinterpret_cast<const std::int32_t*>(base + NETWORK_LAYOUT.hidden2_biases);
+	parsed.hidden2_weights = reinterpret_cast<const std::int8_t*>(base + NETWORK_LAYOUT.hidden2_weights);
+	parsed.output_bias = reinterpret_cast<const std::int32_t*>(base + NETWORK_LAYOUT.output_bias);
+	parsed.output_weights = reinterpret_cast<const std::int8_t*>(base + NETWORK_LAYOUT.output_weights);
+	parsed.output_scale = static_cast<int>(fields[5]);
+	return nullptr;
+}
+
+// This function loads the network from the file. The file is memory-mapped, so the weights aren't copied, and it
+// stays mapped until another network is loaded. Returns nullptr if it's loaded, otherwise the description of the
+// error (the previous network, if any, is kept then).
+const char* load_network(const std::string& path) {
+	try {
+		std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>(path, false);
+		Network parsed{};
+		if (const char* error = parse_network(file->contents(), parsed))
+			return error;
+		network = parsed;
+		network_file = std::move(file);
+		network_memory.clear();
+		network_name = path;
+		network_is_loaded = true;
+		return nullptr;
+	}
+	catch (const char* exception) {
+		return exception;
+	}
+}
+
+// This function unloads the network, so the classical evaluation is used.
+void unload_network() {
+	network_is_loaded = false;
+	network = Network{};
+	network_file.reset();
+	network_memory.clear();
+	network_name.clear();
+}
+
+// This function returns true if a network is loaded.
+bool network_loaded() {
+	return network_is_loaded;
+}
+
+// This function returns the evaluation in use: the network file and the kernels, or the classical evaluation.
+std::string network_info() {
+	if (!network_is_loaded) return "Evaluation: classical";
+	std::ostringstream info;
+	info << "Evaluation: NNUE " << network_name << ", " << NETWORK_LAYOUT.size / (1024 * 1024) << " MB, "
+		<< SIMD_LEVEL_NAMES[simd_level] << " kernels";
+	return info.str();
+}
+
+// This function evaluates the position with the network, computing the accumulator from scratch.
+int evaluate_network(const Position& position) {
+	Accumulator accumulator;
+	refresh_perspective(position, false, accumulator);
+	refresh_perspective(position, true, accumulator);
+	return propagate(accumulator, position.get_active_color());
+}
+
+// This function evaluates the position with the network if one is loaded, otherwise with the classical evaluation.
+int static_evaluation(const Position& position) {
+	return network_is_loaded ? evaluate_network(position) : evaluate(position);
+}
+
+// This function fills a network of the right architecture with random parameters (the same every time) and loads it.
+// The evaluations mean nothing, but they exercise the kernels like a trained network.
+static void load_random_network() {
+	std::vector<char> memory(NETWORK_LAYOUT.size);
+	std::array<std::uint32_t, NETWORK_HEADER_FIELDS> fields{ NETWORK_VERSION, NNUE_FEATURES, NNUE_HALF_DIMENSIONS,
+		NNUE_HIDDEN_1, NNUE_HIDDEN_2, 16 };
+	std::copy(NETWORK_MAGIC.begin(), NETWORK_MAGIC.end(), memory.begin());
+	std::memcpy(memory.data() + NETWORK_MAGIC.size(), fields.data(), sizeof(fields));
+	std::mt19937 generator{ 20240601 };
+	auto fill = [&memory, &generator]<typename T>(std::size_t offset, std::size_t count, int low, int high, T) {
+		std::uniform_int_distribution<int> distribution{ low, high };
+		for (std::size_t i = 0; i < count; ++i) {
+			T value = static_cast<T>(distribution(generator));
+			std::memcpy(memory.data() + offset + i * sizeof(T), &value, sizeof(T));
+		}
+	};
+	fill(NETWORK_LAYOUT.transformer_biases, NNUE_HALF_DIMENSIONS, 0, 64, std::int16_t{});
+	fill(NETWORK_LAYOUT.transformer_weights, NNUE_FEATURES * NNUE_HALF_DIMENSIONS, -24, 24, std::int16_t{});
+	fill(NETWORK_LAYOUT.hidden1_biases, NNUE_HIDDEN_1, -2048, 2048, std::int32_t{});
+	fill(NETWORK_LAYOUT.hidden1_weights, NNUE_HIDDEN_1 * 2 * NNUE_HALF_DIMENSIONS, -8, 8, std::int8_t{});
+	fill(NETWORK_LAYOUT.hidden2_biases, NNUE_HIDDEN_2, -2048, 2048, std::int32_t{});
+	fill(NETWORK_LAYOUT.hidden2_weights, NNUE_HIDDEN_2 * NNUE_HIDDEN_1, -64, 64, std::int8_t{});
+	fill(NETWORK_LAYOUT.output_bias, 1, 0, 0, std::int32_t{});
+	fill(NETWORK_LAYOUT.output_weights, NNUE_HIDDEN_2, -128, 127, std::int8_t{});
+	Network parsed{};
+	parse_network({ memory.data(), memory.size() }, parsed);
+	network = parsed;
+	network_file.reset();
+	network_memory = std::move(memory);
+	network_name = "random network";
+	network_is_loaded = true;
+}
+
+// Evaluations of one pass of the network benchmark.
+struct NetworkBenchmarkPass {
+	std::uint64_t evaluations{};
+	std::int64_t checksum{};
+	std::uint64_t mismatches{};
+};
+
+// This function evaluates the leaves of the perft tree below the position, with the incrementally updated
+// accumulators or from scratch, and adds the evaluations to the checksum. With verify the incremental evaluation is
+// compared with the one from scratch.
+static void network_benchmark_tree(const Position& position, int depth, int ply, AccumulatorStack& accumulators,
+	bool incremental, bool verify, NetworkBenchmarkPass& pass) {
+	if (depth == 0) {
+		int score = incremental ? accumulators.evaluate(position, ply) : evaluate_network(position);
+		if (verify && score != evaluate_network(position)) ++pass.mismatches;
+		++pass.evaluations;
+		pass.checksum += score;
+		return;
+	}
+	MoveList move_list;
+	position.generate_legal_moves(move_list);
+	for (Move move : move_list) {
+		if (incremental) accumulators.push_move(position, move, ply);
+		Position next_position{ position };
+		UndoInfo undo_info;
+		next_position.make_a_move_bitboards(move, undo_info);
+		network_benchmark_tree(next_position, depth - 1, ply + 1, accumulators, incremental, verify, pass);
+	}
+}
+
+// This function runs one pass of the network benchmark over the reference positions.
+static NetworkBenchmarkPass network_benchmark_pass(int depth, bool incremental, bool verify) {
+	NetworkBenchmarkPass pass{};
+	AccumulatorStack accumulators{ depth };
+	for (const PerftPosition& perft_position : PERFT_POSITIONS) {
+		GameData game_data = GameData::create_game_object_from_fen(perft_position.fen);
+		accumulators.reset(game_data);
+		network_benchmark_tree(game_data, depth, 0, accumulators, incremental, verify, pass);
+	}
+	return pass;
+}
+
+// This function checks the network and its kernels on perft trees of the reference positions (to the depth): the
+// incrementally updated accumulators have to match the ones computed from scratch, and every instruction set has to
+// give the same evaluations. Reports the evaluations per second of each instruction set. Without a network file it
+// uses a random network. Returns true if everything matched.
+bool network_benchmark(const std::string& path, int depth) {
+	if (path.empty())
+		load_random_network();
+	else if (const char* error = load_network(path)) {
+		std::cerr << "Error: " << path << ": " << error << '\n';
+		return false;
+	}
+	SimdLevel best_level = best_simd_level();
+	set_simd_level(best_level);
+	std::cout << network_info() << '\n';
+	NetworkBenchmarkPass verify_pass = network_benchmark_pass(depth, true, true);
+	std::cout << "Incremental against from scratch: " << verify_pass.evaluations << " leaves, "
+		<< verify_pass.mismatches << " mismatches" << '\n';
+	bool all_matched = verify_pass.mismatches == 0;
+	// The times include walking the perft trees, which is the same for every pass.
+	std::cout << "Kernels  Accumulators    Evaluations  Mevals/s" << '\n';
+	for (int level = SIMD_SCALAR; level <= best_level; ++level) {
+		set_simd_level(static_cast<SimdLevel>(level));
+		for (bool incremental : { false, true }) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			NetworkBenchmarkPass pass = network_benchmark_pass(depth, incremental, false);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			bool matched = pass.checksum == verify_pass.checksum;
+			all_matched = all_matched && matched;
+			std::cout << std::left << std::setw(9) << SIMD_LEVEL_NAMES[static_cast<std::size_t>(level)]
+				<< std::setw(13) << (incremental ? "incremental" : "from scratch") << std::right << std::setw(14)
+				<< pass.evaluations << std::fixed << std::setprecision(2) << std::setw(10)
+				<< static_cast<double>(pass.evaluations) / seconds / 1e6 << (matched ? "" : "  MISMATCH") << '\n';
+			std::cout.unsetf(std::ios::fixed);
+		}
+	}
+	set_simd_level(best_level);
+	std::cout << (all_matched ? "All evaluations matched." : "Evaluations DIFFER.") << '\n';
+	return all_matched;
+}
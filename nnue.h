@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "move.h"
+#include "position.h"
+
+// Network architecture. The input features are HalfKP: the king square of the perspective together with one other
+// piece (kings excluded) and its square. The feature transformer turns the active features into NNUE_HALF_DIMENSIONS
+// values per perspective; both halves (the side to move first) go through two dense layers into the output.
+constexpr std::size_t NNUE_KING_SQUARES{ 64 };
+// Ten kinds of pieces on 64 squares, plus one unused index.
+constexpr std::size_t NNUE_PIECE_SQUARES{ 10 * 64 + 1 };
+constexpr std::size_t NNUE_FEATURES{ NNUE_KING_SQUARES * NNUE_PIECE_SQUARES };
+constexpr std::size_t NNUE_HALF_DIMENSIONS{ 256 };
+constexpr std::size_t NNUE_HIDDEN_1{ 32 };
+constexpr std::size_t NNUE_HIDDEN_2{ 32 };
+
+// Network file loaded from the working directory at startup (the engine uses the classical evaluation without it).
+inline constexpr char DEFAULT_NETWORK_FILE[]{ "network.nnue" };
+
+// Instruction sets of the network kernels. The best one the CPU supports is chosen at startup.
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 };
+
+// Feature transformer output of one position for both perspectives (indexed by color, 0 - black, 1 - white).
+struct alignas(64) Accumulator {
+	std::array<std::array<std::int16_t, NNUE_HALF_DIMENSIONS>, 2> values;
+	std::array<bool, 2> computed;
+};
+
+// Pieces that one move changes: the moving piece, a captured piece, the promoted piece and the castling rook. Every
+// change is the piece with the square it leaves and the square it enters (NO_CHANGE_SQUARE for a piece that is
+// removed or added). Kings aren't features: a king move makes its side's perspective start from scratch instead.
+struct DirtyPieces {
+	static constexpr std::uint8_t NO_CHANGE_SQUARE{ 64 };
+	std::array<std::uint8_t, 3> piece;
+	std::array<std::uint8_t, 3> from;
+	std::array<std::uint8_t, 3> to;
+	std::uint8_t count;
+	std::array<bool, 2> king_moved;
+};
+
+// Accumulators of the positions along the searched line, indexed by the ply. Making a move only records the pieces
+// it changes; the accumulator is updated from its parent's when the position is evaluated, so moves cut off before
+// any evaluation cost nothing.
+class AccumulatorStack {
+	std::vector<Accumulator> m_accumulators;
+	std::vector<DirtyPieces> m_dirty_pieces;
+
+public:
+	// This function allocates the accumulators for plies 0 to max_ply.
+	explicit AccumulatorStack(int max_ply);
+
+	// This function sets the position at ply 0 and computes its accumulator.
+	void reset(const Position& position);
+
+	// This function records the move about to be made in the position at the ply.
+	void push_move(const Position& position, Move move, int ply);
+
+	// This function evaluates the position at the ply (the root position with the recorded moves made) from the point
+	// of view of the side to move, in centipawns. Needs a loaded network.
+	int evaluate(const Position& position, int ply);
+};
+
+// This function loads the network from the file. The file is memory-mapped, so the weights aren't copied, and it
+// stays mapped until another network is loaded. Returns nullptr if it's loaded, otherwise the description of the
+// error (the previous network, if any, is kept then).
+const char* load_network(const std::string& path);
+
+// This function unloads the network, so the classical evaluation is used.
+void unload_network();
+
+// This function returns true if a network is loaded.
+bool network_loaded();
+
+// This function returns the evaluation in use: the network file and the kernels, or the classical evaluation.
+std::string network_info();
+
+// This function sets the instruction set of the kernels (limited to what the CPU supports) and returns the one set.
+SimdLevel set_simd_level(SimdLevel level);
+
+// This function returns the best instruction set of the kernels that the CPU supports.
+SimdLevel best_simd_level();
+
+// This function evaluates the position with the network, computing the accumulator from scratch.
+int evaluate_network(const Position& position);
+
+// This function evaluates the position with the network if one is loaded, otherwise with the classical evaluation.
+int static_evaluation(const Position& position);
+
+// This function checks the network and its kernels on perft trees of the reference positions (to the depth): the
+// incrementally updated accumulators have to match the ones computed from scratch, and every instruction set has to
+// give the same evaluations. Reports the evaluations per second of each instruction set. Without a network file it
+// uses a random network. Returns true if everything matched.
+bool network_benchmark(const std::string& path, int depth);
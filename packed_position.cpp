@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "packed_position.h"
+
+static_assert(std::endian::native == std::endian::little, "Packed files are read and written in little endian.");
+
+// Start of every packed file and the version of the format.
+static constexpr std::array<char, 4> PACKED_MAGIC{ 'C', 'E', 'P', 'K' };
+static constexpr std::uint8_t PACKED_VERSION{ 1 };
+static constexpr std::size_t PACKED_HEADER_BYTES{ 8 };
+
+// Tags of the records: the whole position or the move from the previous one.
+static constexpr std::uint8_t TAG_POSITION{ 0 };
+static constexpr std::uint8_t TAG_MOVE{ 1 };
+
+// Size of the read and write buffers.
+static constexpr std::size_t PACKED_BUFFER_BYTES{ 1 << 20 };
+
+// Most pieces a packed position can hold.
+static constexpr int MAX_PACKED_PIECES{ 32 };
+
+// Game results in the text files.
+static constexpr std::array<std::string_view, 4> RESULT_STRINGS{ "*", "1-0", "1/2-1/2", "0-1" };
+
+// This function packs the position. Throws the description of the error if it has more than 32 pieces.
+PackedPosition pack_position(const Position& position) {
+	PackedPosition packed_position{};
+	packed_position.occupancy = position.get_occupied();
+	if (std::popcount(packed_position.occupancy) > MAX_PACKED_PIECES) throw "a packed position can't have more than 32 pieces.";
+	std::size_t piece_index{};
+	for (U64 pieces = packed_position.occupancy; pieces; pieces &= pieces - 1, ++piece_index) {
+		int piece = position.piece_on(std::countr_zero(pieces));
+		packed_position.pieces[piece_index >> 1] |= static_cast<std::uint8_t>(piece << ((piece_index & 1) << 2));
+	}
+	packed_position.fullmove_number = static_cast<std::uint16_t>(position.get_fullmove_number());
+	packed_position.flags = static_cast<std::uint8_t>(position.get_active_color() | position.get_castling_rights() << 1);
+	packed_position.en_passant_square = static_cast<std::int8_t>(position.get_en_passant_square());
+	packed_position.halfmove_clock = static_cast<std::uint8_t>(position.get_halfmove_clock());
+	return packed_position;
+}
+
+// This function unpacks the position. Returns nullptr if the packed position is valid, otherwise a description of the
+// error (the position is unusable then).
+const char* unpack_position(const PackedPosition& packed_position, Position& position) {
+	if (std::popcount(packed_position.occupancy) > MAX_PACKED_PIECES) return "more than 32 pieces.";
+	std::array<U64, 6> pieces_bitboards{};
+	U64 white_pieces{};
+	U64 black_pieces{};
+	std::size_t piece_index{};
+	for (U64 pieces = packed_position.occupancy; pieces; pieces &= pieces - 1, ++piece_index) {
+		int piece = (packed_position.pieces[piece_index >> 1] >> ((piece_index & 1) << 2)) & 0xF;
+		if (type_of_piece(piece) > KING) return "invalid piece code.";
+		U64 square_bit = pieces & (~pieces + 1);
+		pieces_bitboards[static_cast<std::size_t>(type_of_piece(piece))] |= square_bit;
+		(is_white_piece(piece) ? white_pieces : black_pieces) |= square_bit;
+	}
+	// The position can only be built from flags and an en passant square in range, the rules are checked on it.
+	bool white = packed_position.flags & 1;
+	int en_passant_square = packed_position.en_passant_square;
+	if (packed_position.flags >> 5) return "invalid flags.";
+	if (en_passant_square < -1 || en_passant_square > 63) return "invalid en passant target square.";
+	position = Position{ pieces_bitboards, white_pieces, black_pieces, white,
+		static_cast<std::uint8_t>(packed_position.flags >> 1), en_passant_square, packed_position.halfmove_clock,
+		packed_position.fullmove_number };
+	return position.check_rules();
+}
+
+// This function writes the header. Without chain_moves every record holds the whole position.
+PackedWriter::PackedWriter(std::ostream& stream, std::uint8_t fields, bool chain_moves)
+	: m_stream{ stream }
+	, m_fields{ static_cast<std::uint8_t>(fields & ALL_PACKED_FIELDS) }
+	, m_chain_moves{ chain_moves }
+{
+	m_buffer.reserve(PACKED_BUFFER_BYTES);
+	std::array<std::uint8_t, PACKED_HEADER_BYTES> header{};
+	std::memcpy(header.data(), PACKED_MAGIC.data(), PACKED_MAGIC.size());
+	header[4] = PACKED_VERSION;
+	header[5] = m_fields;
+	append(header.data(), header.size());
+}
+
+PackedWriter::~PackedWriter() {
+	flush();
+}
+
+// This function appends the bytes to the buffer and writes the buffer out when it's full.
+void PackedWriter::append(const void* bytes, std::size_t count) {
+	const char* characters = static_cast<const char*>(bytes);
+	m_buffer.insert(m_buffer.end(), characters, characters + count);
+	if (m_buffer.size() >= PACKED_BUFFER_BYTES) flush();
+}
+
+// This function appends the optional fields of the file.
+void PackedWriter::append_fields(const PackedRecordData& data) {
+	if (m_fields & FIELD_SCORE) {
+		std::int16_t score = static_cast<std::int16_t>(std::clamp(data.score, -32767, 32767));
+		append(&score, sizeof(score));
+	}
+	if (m_fields & FIELD_RESULT) append(&data.result, sizeof(data.result));
+	if (m_fields & FIELD_BEST_MOVE) append(&data.best_move, sizeof(data.best_move));
+}
+
+// This function finds the legal move that leads from the previous position to this one. Returns NO_MOVE if there
+// is none.
+Move PackedWriter::find_chained_move(const Position& position, const PackedPosition& packed_position) const {
+	// Only a move by the side to move can lead to the position.
+	if (position.get_active_color() == m_previous.get_active_color()) return NO_MOVE;
+	MoveList move_list;
+	m_previous.generate_pseudo_legal_moves(move_list);
+	for (Move move : move_list) {
+		Position next_position = m_previous;
+		UndoInfo undo_info;
+		next_position.make_a_move_bitboards(move, undo_info);
+		// The key doesn't include the counters, so the whole packed positions have to match too. A position that
+		// matches can't have the king in check, so the move is legal.
+		if (next_position.get_key() == position.get_key() && pack_position(next_position) == packed_position)
+			return move;
+	}
+	return NO_MOVE;
+}
+
+// This function writes the position. If it follows from the previously written one by a legal move, only the move is
+// stored. Throws the description of the error if the position can't be packed.
+void PackedWriter::write(const Position& position, const PackedRecordData& data) {
+	PackedPosition packed_position = pack_position(position);
+	Move move = m_chain_moves && m_has_previous ? find_chained_move(position, packed_position) : NO_MOVE;
+	if (move != NO_MOVE) {
+		append(&TAG_MOVE, 1);
+		append(&move, sizeof(move));
+		++m_chained_records;
+	}
+	else {
+		append(&TAG_POSITION, 1);
+		append(&packed_position, sizeof(packed_position));
+	}
+	append_fields(data);
+	m_previous = position;
+	m_has_previous = true;
+	++m_records;
+}
+
+// This function writes the position after the legal move from the previously written position (the move isn't
+// checked, it's meant for game generators that have just made it).
+void PackedWriter::write_move(Move move, const PackedRecordData& data) {
+	if (!m_has_previous) throw "there is no previous position to make the move in.";
+	UndoInfo undo_info;
+	m_previous.make_a_move_bitboards(move, undo_info);
+	append(&TAG_MOVE, 1);
+	append(&move, sizeof(move));
+	append_fields(data);
+	++m_chained_records;
+	++m_records;
+}
+
+// This function writes the buffered records to the stream.
+void PackedWriter::flush() {
+	m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+	m_buffer.clear();
+}
+
+// This function reads the header. Throws the description of the error if the stream isn't a packed file.
+PackedReader::PackedReader(std::istream& stream)
+	: m_stream{ stream }
+	, m_buffer(PACKED_BUFFER_BYTES)
+{
+	std::array<std::uint8_t, PACKED_HEADER_BYTES> header{};
+	if (!read_bytes(header.data(), header.size()) || std::memcmp(header.data(), PACKED_MAGIC.data(), PACKED_MAGIC.size()))
+		throw "not a packed position file.";
+	if (header[4] != PACKED_VERSION) throw "unsupported packed file version.";
+	m_fields = header[5];
+	if (m_fields & ~ALL_PACKED_FIELDS) throw "unknown fields in the packed file.";
+}
+
+// This function copies the next bytes of the input. Returns false if the input ends first.
+bool PackedReader::read_bytes(void* bytes, std::size_t count) {
+	char* characters = static_cast<char*>(bytes);
+	while (count) {
+		if (m_buffer_position == m_buffer_end) {
+			m_stream.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+			m_buffer_position = 0;
+			m_buffer_end = static_cast<std::size_t>(m_stream.gcount());
+			if (!m_buffer_end) return false;
+		}
+		std::size_t copied = std::min(count, m_buffer_end - m_buffer_position);
+		std::memcpy(characters, m_buffer.data() + m_buffer_position, copied);
+		m_buffer_position += copied;
+		characters += copied;
+		count -= copied;
+	}
+	return true;
+}
+
+// This function reads the next record. Returns false at the end of the file. Throws the description of the error if
+// the file is damaged.
+bool PackedReader::read(Position& position, PackedRecordData& data) {
+	std::uint8_t tag{};
+	if (!read_bytes(&tag, 1)) return false;
+	if (tag == TAG_POSITION) {
+		PackedPosition packed_position;
+		if (!read_bytes(&packed_position, sizeof(packed_position))) throw "the packed file ends inside a record.";
+		if (const char* error = unpack_position(packed_position, m_position)) throw error;
+	}
+	else if (tag == TAG_MOVE) {
+		Move move{};
+		if (!read_bytes(&move, sizeof(move))) throw "the packed file ends inside a record.";
+		if (!m_has_position) throw "the packed file starts with a move.";
+		// The move comes from the file, so it's made only if it's legal.
+		MoveList move_list;
+		m_position.generate_pseudo_legal_moves(move_list);
+		if (std::find(move_list.begin(), move_list.end(), move) == move_list.end() || !m_position.is_legal(move))
+			throw "illegal move in the packed file.";
+		UndoInfo undo_info;
+		m_position.make_a_move_bitboards(move, undo_info);
+	}
+	else throw "invalid record in the packed file.";
+	m_has_position = true;
+	data = PackedRecordData{};
+	if (m_fields & FIELD_SCORE) {
+		std::int16_t score{};
+		if (!read_bytes(&score, sizeof(score))) throw "the packed file ends inside a record.";
+		data.score = score;
+	}
+	if ((m_fields & FIELD_RESULT) && (!read_bytes(&data.result, sizeof(data.result)) || data.result > RESULT_BLACK_WINS))
+		throw "invalid game result in the packed file.";
+	if ((m_fields & FIELD_BEST_MOVE) && !read_bytes(&data.best_move, sizeof(data.best_move)))
+		throw "the packed file ends inside a record.";
+	position = m_position;
+	return true;
+}
+
+// This function removes the spaces from both ends of the text.
+static std::string_view trim(std::string_view text) {
+	std::size_t start = text.find_first_not_of(" \t\r");
+	if (start == std::string_view::npos) return {};
+	return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+// This function reads a line of the text format, "<fen>[ ; score <cp>][ ; result <1-0|1/2-1/2|0-1|*>][ ; bestmove
+// <move>]", into the position and the fields. Returns nullptr if it's valid, otherwise a description of the error.
+static const char* parse_text_record(std::string_view line, Position& position, PackedRecordData& data) {
+	std::size_t separator = line.find(';');
+	if (const char* error = position.set_fen(trim(line.substr(0, separator)))) return error;
+	data = PackedRecordData{};
+	while (separator != std::string_view::npos) {
+		std::size_t next_separator = line.find(';', separator + 1);
+		std::string_view field = trim(line.substr(separator + 1, next_separator - separator - 1));
+		separator = next_separator;
+		std::size_t space = field.find(' ');
+		std::string_view name = field.substr(0, space);
+		std::string_view value = space == std::string_view::npos ? std::string_view{} : trim(field.substr(space));
+		if (name == "score") {
+			std::from_chars_result result = std::from_chars(value.data(), value.data() + value.size(), data.score);
+			if (result.ec != std::errc{} || result.ptr != value.data() + value.size()) return "the score has to be a number.";
+		}
+		else if (name == "result") {
+			auto result = std::find(RESULT_STRINGS.begin(), RESULT_STRINGS.end(), value);
+			if (result == RESULT_STRINGS.end()) return "the result has to be 1-0, 1/2-1/2, 0-1 or *.";
+			data.result = static_cast<GameResult>(result - RESULT_STRINGS.begin());
+		}
+		else if (name == "bestmove" && value == "0000") data.best_move = NO_MOVE;
+		else if (name == "bestmove") {
+			MoveList move_list;
+			position.generate_legal_moves(move_list);
+			auto move = std::find_if(move_list.begin(), move_list.end(), [value](Move legal_move) {
+				return move_to_string(legal_move) == value;
+			});
+			if (move == move_list.end()) return "the best move isn't a legal move.";
+			data.best_move = *move;
+		}
+		else if (!name.empty()) return "unknown field.";
+	}
+	return nullptr;
+}
+
+// This function runs the "pack <text file> <packed file> [--score] [--result] [--bestmove]" command line mode: it
+// converts the FEN lines into a packed file. Returns the exit code of the program.
+int pack_command(const std::vector<std::string>& arguments) {
+	try {
+		if (arguments.size() < 2) throw "missing input or output file.";
+		std::uint8_t fields{};
+		for (std::size_t i = 2; i < arguments.size(); ++i) {
+			if (arguments[i] == "--score") fields |= FIELD_SCORE;
+			else if (arguments[i] == "--result") fields |= FIELD_RESULT;
+			else if (arguments[i] == "--bestmove") fields |= FIELD_BEST_MOVE;
+			else throw "unknown option.";
+		}
+		std::ifstream input(arguments[0]);
+		if (!input) throw "can't open the input file.";
+		std::ofstream output(arguments[1], std::ios::binary);
+		if (!output) throw "can't create the output file.";
+		std::uint64_t invalid_lines{};
+		std::uint64_t line_number{};
+		std::string line{};
+		Position position{};
+		PackedRecordData data{};
+		{
+			PackedWriter writer{ output, fields };
+			while (std::getline(input, line)) {
+				++line_number;
+				if (trim(line).empty() || line[0] == '#') continue;
+				if (const char* error = parse_text_record(line, position, data)) {
+					std::cerr << "Line " << line_number << ": " << error << '\n';
+					++invalid_lines;
+					continue;
+				}
+				writer.write(position, data);
+			}
+			std::cout << "Positions: " << writer.records() << " (" << writer.chained_records() << " stored as moves), "
+				<< "invalid lines: " << invalid_lines << '\n';
+		}
+		if (!output) throw "can't write the output file.";
+		std::cout << "Packed size: " << output.tellp() << " bytes" << '\n';
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << '\n';
+		std::cerr << "Usage: pack <text file> <packed file> [--score] [--result] [--bestmove]" << '\n';
+		return 1;
+	}
+	return 0;
+}
+
+// This function runs the "unpack <packed file> <text file>" command line mode: it converts the packed file into FEN
+// lines. Returns the exit code of the program.
+int unpack_command(const std::vector<std::string>& arguments) {
+	std::uint64_t positions{};
+	try {
+		if (arguments.size() != 2) throw "missing input or output file.";
+		std::ifstream input(arguments[0], std::ios::binary);
+		if (!input) throw "can't open the input file.";
+		std::ofstream output(arguments[1]);
+		if (!output) throw "can't create the output file.";
+		PackedReader reader{ input };
+		Position position{};
+		PackedRecordData data{};
+		std::array<char, MAX_FEN_LENGTH> fen;
+		std::string line{};
+		while (reader.read(position, data)) {
+			line.assign(fen.data(), position.write_fen(fen.data()));
+			if (reader.fields() & FIELD_SCORE) line += " ; score " + std::to_string(data.score);
+			if (reader.fields() & FIELD_RESULT) {
+				line += " ; result ";
+				line += RESULT_STRINGS[data.result];
+			}
+			if (reader.fields() & FIELD_BEST_MOVE)
+				line += " ; bestmove " + (data.best_move == NO_MOVE ? std::string{ "0000" } : move_to_string(data.best_move));
+			line += '\n';
+			output << line;
+			++positions;
+		}
+		if (!output) throw "can't write the output file.";
+		std::cout << "Positions: " << positions << '\n';
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << " (after " << positions << " positions)" << '\n';
+		std::cerr << "Usage: unpack <packed file> <text file>" << '\n';
+		return 1;
+	}
+	return 0;
+}
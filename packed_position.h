@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "move.h"
+#include "position.h"
+
+// Position packed into 32 bytes: the occupied squares, the pieces on them (4 bits each, in the order of the squares,
+// the same codes as in the mailbox) and the rest of the FEN data. Multi-byte fields are little endian.
+struct PackedPosition {
+	U64 occupancy;
+	std::array<std::uint8_t, 16> pieces;
+	std::uint16_t fullmove_number;
+	std::uint8_t flags;								// Bit 0 - white to move, bits 1-4 - castling rights.
+	std::int8_t en_passant_square;					// -1 if there is no en passant target square.
+	std::uint8_t halfmove_clock;
+	std::array<std::uint8_t, 3> reserved;			// Always zero.
+
+	bool operator==(const PackedPosition&) const = default;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition has to be 32 bytes.");
+static_assert(std::is_trivially_copyable_v<PackedPosition>, "PackedPosition has to be trivially copyable.");
+
+// This function packs the position. Throws the description of the error if it has more than 32 pieces.
+PackedPosition pack_position(const Position& position);
+
+// This function unpacks the position. Returns nullptr if the packed position is valid, otherwise a description of the
+// error (the position is unusable then).
+const char* unpack_position(const PackedPosition& packed_position, Position& position);
+
+// Result of the game a position comes from.
+enum GameResult : std::uint8_t { RESULT_UNKNOWN, RESULT_WHITE_WINS, RESULT_DRAW, RESULT_BLACK_WINS };
+
+// Optional fields stored with every record of a packed file. The file header says which of them the file has.
+enum PackedField : std::uint8_t { FIELD_SCORE = 1, FIELD_RESULT = 2, FIELD_BEST_MOVE = 4 };
+constexpr std::uint8_t ALL_PACKED_FIELDS{ FIELD_SCORE | FIELD_RESULT | FIELD_BEST_MOVE };
+
+// Values of the optional fields of one record.
+struct PackedRecordData {
+	int score{};									// Centipawns from the point of view of the side to move.
+	GameResult result{ RESULT_UNKNOWN };
+	Move best_move{ NO_MOVE };
+};
+
+// Writer of packed files. A file starts with an 8-byte header (the magic "CEPK", the format version and the fields of
+// the records). Then there are the records: a tag byte and either a whole packed position (33 bytes) or, when the
+// position follows from the previous one by a move (consecutive positions of a game), only the move (3 bytes).
+// The optional fields follow. The output is buffered, it's written by flush and by the destructor.
+class PackedWriter {
+	std::ostream& m_stream;
+	std::uint8_t m_fields;
+	bool m_chain_moves;
+	std::vector<char> m_buffer{};
+	Position m_previous{};
+	bool m_has_previous{};
+	std::uint64_t m_records{};
+	std::uint64_t m_chained_records{};
+
+	// This function appends the bytes to the buffer and writes the buffer out when it's full.
+	void append(const void* bytes, std::size_t count);
+
+	// This function appends the optional fields of the file.
+	void append_fields(const PackedRecordData& data);
+
+	// This function finds the legal move that leads from the previous position to this one. Returns NO_MOVE if there
+	// is none.
+	Move find_chained_move(const Position& position, const PackedPosition& packed_position) const;
+
+public:
+	// This function writes the header. Without chain_moves every record holds the whole position.
+	PackedWriter(std::ostream& stream, std::uint8_t fields, bool chain_moves = true);
+	PackedWriter(const PackedWriter&) = delete;
+	PackedWriter& operator=(const PackedWriter&) = delete;
+	~PackedWriter();
+
+	// This function writes the position. If it follows from the previously written one by a legal move, only the move is
+	// stored. Throws the description of the error if the position can't be packed.
+	void write(const Position& position, const PackedRecordData& data = {});
+
+	// This function writes the position after the legal move from the previously written position (the move isn't
+	// checked, it's meant for game generators that have just made it).
+	void write_move(Move move, const PackedRecordData& data = {});
+
+	// This function writes the buffered records to the stream.
+	void flush();
+
+	// These functions return the number of records written and how many of them were stored as moves.
+	std::uint64_t records() const { return m_records; }
+	std::uint64_t chained_records() const { return m_chained_records; }
+};
+
+// Reader of packed files (see PackedWriter). The input is read in large blocks.
+class PackedReader {
+	std::istream& m_stream;
+	std::uint8_t m_fields{};
+	std::vector<char> m_buffer;
+	std::size_t m_buffer_position{};
+	std::size_t m_buffer_end{};
+	Position m_position{};
+	bool m_has_position{};
+
+	// This function copies the next bytes of the input. Returns false if the input ends first.
+	bool read_bytes(void* bytes, std::size_t count);
+
+public:
+	// This function reads the header. Throws the description of the error if the stream isn't a packed file.
+	explicit PackedReader(std::istream& stream);
+
+	// This function reads the next record. Returns false at the end of the file. Throws the description of the error if
+	// the file is damaged.
+	bool read(Position& position, PackedRecordData& data);
+
+	// This function returns the optional fields of the records.
+	std::uint8_t fields() const { return m_fields; }
+};
+
+// This function runs the "pack <text file> <packed file> [--score] [--result] [--bestmove]" command line mode: it
+// converts the FEN lines into a packed file. Returns the exit code of the program.
+int pack_command(const std::vector<std::string>& arguments);
+
+// This function runs the "unpack <packed file> <text file>" command line mode: it converts the packed file into FEN
+// lines. Returns the exit code of the program.
+int unpack_command(const std::vector<std::string>& arguments);
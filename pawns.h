@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "position.h"
+#include "psqt.h"
+
+// Number of entries of a pawn hash table (a power of two).
+constexpr std::size_t PAWN_TABLE_ENTRIES{ 1 << 14 };
+
+// Pawn structure of one pawn key: the score of the terms that only depend on the pawns and the bitboards the other
+// terms use. Arrays are indexed by color (0 - black, 1 - white). A default entry is the one of the board without pawns.
+struct PawnEntry {
+	U64 key{};
+	// Doubled, isolated and backward pawns, from White's point of view.
+	Score score{};
+	std::array<U64, 2> passed_pawns{};
+	std::array<U64, 2> pawn_attacks{};
+	// Squares the pawns of the color attack now or can attack after advancing.
+	std::array<U64, 2> attack_spans{};
+	// Pawn shield score of the color's king on the square (-1 until it's computed). The king doesn't move often, so
+	// it's kept for the last square.
+	std::array<std::int8_t, 2> shelter_king_squares{ -1, -1 };
+	std::array<Score, 2> shelter{};
+};
+
+// Pawn hash table: a cache of the pawn structure evaluation indexed by the pawn key. The pawns change in few moves, so
+// most evaluations find their entry here. Every search thread has its own table, so it needs no locking.
+class PawnTable {
+	std::vector<PawnEntry> m_entries;
+	std::uint64_t m_probes{};
+	std::uint64_t m_hits{};
+
+public:
+	PawnTable() : m_entries(PAWN_TABLE_ENTRIES) {}
+
+	// This function returns the entry of the pawn key's slot. found is true if the entry is already the key's,
+	// otherwise the entry has to be filled.
+	PawnEntry& probe(U64 pawn_key, bool& found) {
+		++m_probes;
+		PawnEntry& entry = m_entries[static_cast<std::size_t>(pawn_key) & (m_entries.size() - 1)];
+		found = entry.key == pawn_key;
+		m_hits += found;
+		return entry;
+	}
+
+	// These functions return the number of probes and of the probes that found their entry.
+	std::uint64_t probes() const { return m_probes; }
+	std::uint64_t hits() const { return m_hits; }
+};
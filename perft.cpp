@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#include "perft.h"
+#include "thread_pool.h"
+
+// Deepest split point of the parallel perft.
+static constexpr int MAX_SPLIT_DEPTH{ 8 };
+
+// Number of runs of each move generator in the benchmark.
+static constexpr int MOVEGEN_BENCHMARK_RUNS{ 3 };
+
+// Default split point. Two plies give a few hundred to a few thousand tasks, enough to keep all workers busy.
+static constexpr int DEFAULT_SPLIT_DEPTH{ 2 };
+
+// Subtree of the parallel perft: the moves from the root to the split point and the root move it belongs to.
+struct PerftTask {
+	std::array<Move, MAX_SPLIT_DEPTH> moves;
+	int length;
+	std::size_t root_move;
+};
+
+// Standard perft reference positions (https://www.chessprogramming.org/Perft_Results).
+const std::array<PerftPosition, 6> PERFT_POSITIONS{ {
+	{ "Start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		{ 20, 400, 8902, 197281, 4865609, 119060324 } },
+	{ "Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		{ 48, 2039, 97862, 4085603, 193690690 } },
+	{ "Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		{ 14, 191, 2812, 43238, 674624, 11030083 } },
+	{ "Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		{ 6, 264, 9467, 422333, 15833292 } },
+	{ "Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		{ 44, 1486, 62379, 2103487, 89941194 } },
+	{ "Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		{ 46, 2079, 89890, 3894594, 164075551 } }
+} };
+
+// This function returns seconds passed since the start.
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// This function prints the node count, the time and the node rate.
+static void print_node_rate(std::uint64_t nodes, double seconds) {
+	std::cout << "Nodes: " << nodes << ", time: " << std::fixed << std::setprecision(3) << seconds << " s, "
+		<< std::setprecision(2) << (seconds > 0 ? static_cast<double>(nodes) / seconds / 1e6 : 0.0) << " Mnps" << '\n';
+	std::cout.unsetf(std::ios::fixed);
+}
+
+// This function counts the leaf nodes of the move tree to the depth. With bulk counting the moves of the last ply are
+// counted from the move list without making them.
+std::uint64_t perft(GameData& game_data, int depth, bool bulk_counting) {
+	if (depth == 0) return 1;
+	MoveList move_list;
+	game_data.generate_legal_moves(move_list);
+	if (bulk_counting && depth == 1) return move_list.size();
+	std::uint64_t nodes{};
+	for (Move move : move_list) {
+		game_data.make_move(move);
+		nodes += perft(game_data, depth - 1, bulk_counting);
+		game_data.unmake_move();
+	}
+	return nodes;
+}
+
+// Copy-make version of perft: every move is made on a copy of the position. Only used to compare with make/unmake.
+static std::uint64_t perft_copy_make(const Position& position, int depth) {
+	if (depth == 0) return 1;
+	MoveList move_list;
+	position.generate_legal_moves(move_list);
+	std::uint64_t nodes{};
+	for (Move move : move_list) {
+		Position next_position{ position };
+		UndoInfo undo_info;
+		next_position.make_a_move_bitboards(move, undo_info);
+		nodes += perft_copy_make(next_position, depth - 1);
+	}
+	return nodes;
+}
+
+// This function prints the node count after each root move, the total node count and nodes per second.
+std::uint64_t perft_divide(GameData& game_data, int depth, bool bulk_counting) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	MoveList move_list;
+	game_data.generate_legal_moves(move_list);
+	std::uint64_t total_nodes{};
+	for (Move move : move_list) {
+		game_data.make_move(move);
+		std::uint64_t nodes = perft(game_data, depth - 1, bulk_counting);
+		game_data.unmake_move();
+		std::cout << move_to_string(move) << ": " << nodes << '\n';
+		total_nodes += nodes;
+	}
+	std::cout << '\n' << "Moves: " << move_list.size() << '\n';
+	print_node_rate(total_nodes, seconds_since(start));
+	return total_nodes;
+}
+
+// This function collects the paths to all positions at the split depth into the tasks.
+static void collect_perft_tasks(GameData& game_data, int split_depth, PerftTask& path, std::vector<PerftTask>& tasks) {
+	if (path.length == split_depth) {
+		tasks.push_back(path);
+		return;
+	}
+	MoveList move_list;
+	game_data.generate_legal_moves(move_list);
+	for (std::size_t i = 0; i < move_list.size(); ++i) {
+		if (path.length == 0) path.root_move = i;
+		path.moves[static_cast<std::size_t>(path.length++)] = move_list[i];
+		game_data.make_move(move_list[i]);
+		collect_perft_tasks(game_data, split_depth, path, tasks);
+		game_data.unmake_move();
+		--path.length;
+	}
+}
+
+// This function counts the leaf nodes with several threads. The tree is split into tasks at split_depth plies from the
+// root, and the tasks are shared by a work-stealing thread pool where every worker owns its own copy of the game. With
+// print_divide it prints the node count after each root move and the node rate.
+std::uint64_t perft_parallel(const GameData& game_data, int depth, bool bulk_counting, std::size_t thread_count,
+	int split_depth, bool print_divide) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	GameData root_game_data{ game_data };
+	if (depth < 2)
+		return print_divide ? perft_divide(root_game_data, depth, bulk_counting) : perft(root_game_data, depth, bulk_counting);
+	// At least one ply has to be left below the split point.
+	split_depth = std::clamp(split_depth, 1, std::min(depth - 1, MAX_SPLIT_DEPTH));
+
+	MoveList root_moves;
+	root_game_data.generate_legal_moves(root_moves);
+	std::vector<PerftTask> tasks{};
+	PerftTask path{};
+	collect_perft_tasks(root_game_data, split_depth, path, tasks);
+
+	// Deal the tasks to the workers round-robin, stealing evens out the rest.
+	WorkStealingPool<PerftTask> pool(thread_count);
+	for (std::size_t i = 0; i < tasks.size(); ++i)
+		pool.push(i, tasks[i]);
+
+	std::vector<std::atomic<std::uint64_t>> root_move_nodes(root_moves.size());
+	std::vector<std::uint64_t> worker_nodes(pool.thread_count());
+	pool.run([&](std::size_t worker, WorkStealingPool<PerftTask>& worker_pool) {
+		// Every worker has its own copy of the game, so workers never touch each other's data.
+		GameData worker_game_data{ game_data };
+		PerftTask task{};
+		std::uint64_t nodes{};
+		while (worker_pool.pop(worker, task)) {
+			for (int i = 0; i < task.length; ++i)
+				worker_game_data.make_move(task.moves[static_cast<std::size_t>(i)]);
+			std::uint64_t task_nodes = perft(worker_game_data, depth - task.length, bulk_counting);
+			for (int i = 0; i < task.length; ++i)
+				worker_game_data.unmake_move();
+			root_move_nodes[task.root_move] += task_nodes;
+			nodes += task_nodes;
+		}
+		worker_nodes[worker] = nodes;
+	});
+
+	std::uint64_t total_nodes{};
+	for (std::size_t i = 0; i < root_moves.size(); ++i) {
+		if (print_divide)
+			std::cout << move_to_string(root_moves[i]) << ": " << root_move_nodes[i] << '\n';
+		total_nodes += root_move_nodes[i];
+	}
+	if (print_divide) {
+		std::cout << '\n' << "Moves: " << root_moves.size() << ", threads: " << pool.thread_count() << ", tasks: "
+			<< tasks.size() << ", steals: " << pool.steals() << '\n';
+		std::cout << "Nodes per thread:";
+		for (std::uint64_t nodes : worker_nodes)
+			std::cout << ' ' << nodes;
+		std::cout << '\n';
+		print_node_rate(total_nodes, seconds_since(start));
+	}
+	return total_nodes;
+}
+
+// This function runs the parallel perft with 1, 2, 4 ... max_threads threads and prints the speedup and the scaling
+// efficiency of each thread count. Returns true if all thread counts got the same node count.
+bool perft_scaling(const GameData& game_data, int depth, bool bulk_counting, std::size_t max_threads, int split_depth) {
+	std::vector<std::size_t> thread_counts{};
+	for (std::size_t threads = 1; threads < max_threads; threads *= 2)
+		thread_counts.push_back(threads);
+	thread_counts.push_back(max_threads);
+
+	std::uint64_t reference_nodes{};
+	double reference_seconds{};
+	bool all_matched{ true };
+	std::cout << "Threads        Nodes     Time      Mnps   Speedup  Efficiency" << '\n';
+	for (std::size_t threads : thread_counts) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::uint64_t nodes = perft_parallel(game_data, depth, bulk_counting, threads, split_depth, false);
+		double seconds = seconds_since(start);
+		if (threads == 1) {
+			reference_nodes = nodes;
+			reference_seconds = seconds;
+		}
+		double speedup = seconds > 0 ? reference_seconds / seconds : 0.0;
+		bool matched = nodes == reference_nodes;
+		all_matched = all_matched && matched;
+		std::cout << std::setw(7) << threads << std::setw(13) << nodes << std::fixed << std::setprecision(3)
+			<< std::setw(9) << seconds << std::setprecision(2) << std::setw(10)
+			<< (seconds > 0 ? static_cast<double>(nodes) / seconds / 1e6 : 0.0) << std::setw(10) << speedup
+			<< std::setw(11) << speedup / static_cast<double>(threads) * 100 << '%'
+			<< (matched ? "" : "  MISMATCH") << '\n';
+		std::cout.unsetf(std::ios::fixed);
+	}
+	return all_matched;
+}
+
+// This function runs perft on all reference positions up to the depth, compares the node counts with the expected ones
+// and reports nodes per second. Returns true if all counts matched.
+bool perft_suite(int max_depth, bool bulk_counting, std::size_t thread_count, int split_depth) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::uint64_t total_nodes{};
+	bool all_passed{ true };
+	for (const PerftPosition& position : PERFT_POSITIONS) {
+		GameData game_data = GameData::create_game_object_from_fen(position.fen);
+		// Don't go deeper than the known counts.
+		int depth = std::min(max_depth, static_cast<int>(position.expected_nodes.size()));
+		std::chrono::steady_clock::time_point position_start = std::chrono::steady_clock::now();
+		std::uint64_t nodes = thread_count > 1 ? perft_parallel(game_data, depth, bulk_counting, thread_count, split_depth, false)
+			: perft(game_data, depth, bulk_counting);
+		std::uint64_t expected = position.expected_nodes[static_cast<std::size_t>(depth - 1)];
+		bool passed = nodes == expected;
+		all_passed = all_passed && passed;
+		total_nodes += nodes;
+		std::cout << std::left << std::setw(16) << position.name << std::right << " depth " << depth << ": " << nodes
+			<< (passed ? " OK" : " FAILED (expected " + std::to_string(expected) + ")") << '\n';
+		print_node_rate(nodes, seconds_since(position_start));
+	}
+	std::cout << '\n' << (all_passed ? "All positions passed." : "Some positions FAILED.") << '\n';
+	print_node_rate(total_nodes, seconds_since(start));
+	return all_passed;
+}
+
+// This function compares copy-make perft (copying the position for every move) with make/unmake perft on the
+// reference positions. Returns true if both got the same node counts.
+bool make_move_benchmark(int depth) {
+	bool all_matched{ true };
+	double copy_make_total_seconds{};
+	double make_unmake_total_seconds{};
+	std::cout << "Position size: " << sizeof(Position) << " bytes, game object size: " << sizeof(GameData) << " bytes"
+		<< '\n';
+	std::cout << "Position            Nodes  Copy-make Mnps  Make/unmake Mnps  Speedup" << '\n';
+	for (const PerftPosition& position : PERFT_POSITIONS) {
+		GameData game_data = GameData::create_game_object_from_fen(position.fen);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::uint64_t copy_make_nodes = perft_copy_make(game_data, depth);
+		double copy_make_seconds = seconds_since(start);
+		start = std::chrono::steady_clock::now();
+		std::uint64_t make_unmake_nodes = perft(game_data, depth, false);
+		double make_unmake_seconds = seconds_since(start);
+		all_matched = all_matched && copy_make_nodes == make_unmake_nodes;
+		copy_make_total_seconds += copy_make_seconds;
+		make_unmake_total_seconds += make_unmake_seconds;
+		std::cout << std::left << std::setw(16) << position.name << std::right << std::setw(9) << make_unmake_nodes
+			<< std::fixed << std::setprecision(2) << std::setw(16) << static_cast<double>(copy_make_nodes) / copy_make_seconds / 1e6
+			<< std::setw(18) << static_cast<double>(make_unmake_nodes) / make_unmake_seconds / 1e6 << std::setw(9)
+			<< copy_make_seconds / make_unmake_seconds << (copy_make_nodes == make_unmake_nodes ? "" : "  MISMATCH") << '\n';
+		std::cout.unsetf(std::ios::fixed);
+	}
+	std::cout << "Total speedup of make/unmake: " << std::fixed << std::setprecision(2)
+		<< copy_make_total_seconds / make_unmake_total_seconds << '\n';
+	std::cout.unsetf(std::ios::fixed);
+	return all_matched;
+}
+
+// Bulk counting perft with the runtime color move generator or the color templates. Only used by the benchmark.
+template <bool Runtime>
+static std::uint64_t perft_generator(GameData& game_data, int depth) {
+	MoveList move_list;
+	if constexpr (Runtime) game_data.generate_legal_moves_runtime(move_list);
+	else game_data.generate_legal_moves(move_list);
+	if (depth <= 1) return move_list.size();
+	std::uint64_t nodes{};
+	for (Move move : move_list) {
+		game_data.make_move(move);
+		nodes += perft_generator<Runtime>(game_data, depth - 1);
+		game_data.unmake_move();
+	}
+	return nodes;
+}
+
+// This function compares the move generator with runtime color branches and the one specialized for the color at
+// compile time (bulk counting perft of the reference positions). Returns true if both got the same node counts.
+bool movegen_benchmark(int depth) {
+	bool all_matched{ true };
+	double runtime_total_seconds{};
+	double template_total_seconds{};
+	std::cout << "Position               Nodes  Runtime Mnps  Template Mnps  Speedup" << '\n';
+	for (const PerftPosition& position : PERFT_POSITIONS) {
+		GameData game_data = GameData::create_game_object_from_fen(position.fen);
+		std::uint64_t runtime_nodes{};
+		std::uint64_t template_nodes{};
+		double runtime_seconds{ std::numeric_limits<double>::max() };
+		double template_seconds{ std::numeric_limits<double>::max() };
+		// The versions take turns and the fastest run of each counts, so a slow moment of the machine doesn't decide.
+		for (int run = 0; run < MOVEGEN_BENCHMARK_RUNS; ++run) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			runtime_nodes = perft_generator<true>(game_data, depth);
+			runtime_seconds = std::min(runtime_seconds, seconds_since(start));
+			start = std::chrono::steady_clock::now();
+			template_nodes = perft_generator<false>(game_data, depth);
+			template_seconds = std::min(template_seconds, seconds_since(start));
+		}
+		all_matched = all_matched && runtime_nodes == template_nodes;
+		runtime_total_seconds += runtime_seconds;
+		template_total_seconds += template_seconds;
+		std::cout << std::left << std::setw(16) << position.name << std::right << std::setw(12) << template_nodes
+			<< std::fixed << std::setprecision(2) << std::setw(14) << static_cast<double>(runtime_nodes) / runtime_seconds / 1e6
+			<< std::setw(15) << static_cast<double>(template_nodes) / template_seconds / 1e6 << std::setw(9)
+			<< runtime_seconds / template_seconds << (runtime_nodes == template_nodes ? "" : "  MISMATCH") << '\n';
+		std::cout.unsetf(std::ios::fixed);
+	}
+	std::cout << "Total speedup of the color templates: " << std::fixed << std::setprecision(2)
+		<< runtime_total_seconds / template_total_seconds << '\n';
+	std::cout.unsetf(std::ios::fixed);
+	return all_matched;
+}
+
+// This function runs the perft command line mode: "perft <depth> [options] [fen]" or "perft suite [depth] [options]".
+// Options: --bulk, --threads <n>, --split <plies>, --scaling. Returns the exit code of the program.
+int perft_command(const std::vector<std::string>& arguments) {
+	bool bulk_counting{};
+	bool scaling{};
+	std::size_t thread_count{ 1 };
+	int split_depth{ DEFAULT_SPLIT_DEPTH };
+	std::vector<std::string> other_arguments{};
+	try {
+		for (std::size_t i = 0; i < arguments.size(); ++i) {
+			if (arguments[i] == "--bulk") bulk_counting = true;
+			else if (arguments[i] == "--scaling") scaling = true;
+			else if (arguments[i] == "--threads" || arguments[i] == "--split") {
+				if (i + 1 == arguments.size()) throw "missing option value.";
+				int value = std::stoi(arguments[++i]);
+				if (value < 1) throw "option value has to be at least 1.";
+				if (arguments[i - 1] == "--threads") thread_count = static_cast<std::size_t>(value);
+				else split_depth = value;
+			}
+			else other_arguments.push_back(arguments[i]);
+		}
+		// Scaling runs up to all hardware threads unless the thread count is given.
+		if (scaling && thread_count == 1)
+			thread_count = std::max(1U, std::thread::hardware_concurrency());
+		if (other_arguments.empty())
+			throw "missing depth.";
+		// Reference positions with default depth 5.
+		if (other_arguments[0] == "suite") {
+			int max_depth = other_arguments.size() > 1 ? std::stoi(other_arguments[1]) : 5;
+			if (max_depth < 1) throw "depth has to be at least 1.";
+			return perft_suite(max_depth, bulk_counting, thread_count, split_depth) ? 0 : 1;
+		}
+		int depth = std::stoi(other_arguments[0]);
+		if (depth < 1) throw "depth has to be at least 1.";
+		// The rest of the arguments is the FEN (split by spaces).
+		std::string fen{};
+		for (std::size_t i = 1; i < other_arguments.size(); ++i)
+			fen += (i > 1 ? " " : "") + other_arguments[i];
+		GameData game_data = fen.empty() ? GameData::create_game_object_start_pos() : GameData::create_game_object_from_fen(fen);
+		if (scaling)
+			return perft_scaling(game_data, depth, bulk_counting, thread_count, split_depth) ? 0 : 1;
+		if (thread_count > 1)
+			perft_parallel(game_data, depth, bulk_counting, thread_count, split_depth, true);
+		else
+			perft_divide(game_data, depth, bulk_counting);
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << '\n';
+		std::cerr << "Usage: perft <depth> [--bulk] [--threads n] [--split plies] [--scaling] [fen]" << '\n';
+		std::cerr << "       perft suite [depth] [--bulk] [--threads n] [--split plies]" << '\n';
+		return 1;
+	}
+	catch (const std::exception&) {
+		std::cerr << "Error: depth and option values have to be numbers." << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game_class.h"
+
+// Reference position with known perft node counts.
+struct PerftPosition {
+	std::string name;
+	std::string fen;
+	// Expected node counts for depth 1, 2, 3 ...
+	std::vector<std::uint64_t> expected_nodes;
+};
+
+// Standard perft reference positions (https://www.chessprogramming.org/Perft_Results).
+extern const std::array<PerftPosition, 6> PERFT_POSITIONS;
+
+// This function counts the leaf nodes of the move tree to the depth. With bulk counting the moves of the last ply are
+// counted from the move list without making them.
+std::uint64_t perft(GameData& game_data, int depth, bool bulk_counting);
+
+// This function prints the node count after each root move, the total node count and nodes per second.
+std::uint64_t perft_divide(GameData& game_data, int depth, bool bulk_counting);
+
+// This function counts the leaf nodes with several threads. The tree is split into tasks at split_depth plies from the
+// root, and the tasks are shared by a work-stealing thread pool where every worker owns its own copy of the game. With
+// print_divide it prints the node count after each root move and the node rate.
+std::uint64_t perft_parallel(const GameData& game_data, int depth, bool bulk_counting, std::size_t thread_count,
+	int split_depth, bool print_divide);
+
+// This function runs the parallel perft with 1, 2, 4 ... max_threads threads and prints the speedup and the scaling
+// efficiency of each thread count. Returns true if all thread counts got the same node count.
+bool perft_scaling(const GameData& game_data, int depth, bool bulk_counting, std::size_t max_threads, int split_depth);
+
+// This function runs perft on all reference positions up to the depth, compares the node counts with the expected ones
+// and reports nodes per second. Returns true if all counts matched.
+bool perft_suite(int max_depth, bool bulk_counting, std::size_t thread_count, int split_depth);
+
+// This function compares copy-make perft (copying the position for every move) with make/unmake perft on the
+// reference positions. Returns true if both got the same node counts.
+bool make_move_benchmark(int depth);
+
+// This function compares the move generator with runtime color branches and the one specialized for the color at
+// compile time (bulk counting perft of the reference positions). Returns true if both got the same node counts.
+bool movegen_benchmark(int depth);
+
+// This function runs the perft command line mode: "perft <depth> [options] [fen]" or "perft suite [depth] [options]".
+// Options: --bulk, --threads <n>, --split <plies>, --scaling. Returns the exit code of the program.
+int perft_command(const std::vector<std::string>& arguments);
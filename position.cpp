@@ -0,0 +1,267 @@
+#include <array>
+#include <bit>
+#include "attacks.h"
+#include "position.h"
+#include "zobrist.h"
+
+#if defined(_DEBUG) || defined(ZOBRIST_DEBUG)
+#include <cstdlib>
+#include <iostream>
+#endif
+
+#define set_bit(b, i) ((b) |= (1ULL << i))
+#define get_bit(b, i) ((b) & (1ULL << i))
+#define clear_bit(b, i) ((b) &= ~(1ULL << i))
+
+Position::Position(std::array<U64, 6> all_pieces_bitboards, U64 white_pieces, U64 black_pieces, bool active_color,
+	std::uint8_t castling_rights, int en_passant_square, int halfmove_clock, int fullmove_number)
+	: m_all_pieces_bitboards{ all_pieces_bitboards }
+	, m_white_pieces{ white_pieces }
+	, m_black_pieces{ black_pieces }
+	, m_active_color{ active_color }
+	, m_castling_rights{ castling_rights }
+	, m_en_passant_square{ static_cast<std::int8_t>(en_passant_square) }
+	, m_halfmove_clock{ static_cast<std::uint8_t>(halfmove_clock) }
+	, m_fullmove_number{ static_cast<std::uint16_t>(fullmove_number) }
+{
+	fill_mailbox();
+	m_key = compute_key();
+	m_pawn_key = compute_pawn_key();
+	m_psq_score = compute_psq_score();
+	m_phase = static_cast<std::uint8_t>(compute_phase());
+}
+
+// This function fills the mailbox from the bitboards.
+void Position::fill_mailbox() {
+	// Both nibbles of every byte are empty squares.
+	m_mailbox.fill(static_cast<std::uint8_t>(NO_PIECE | NO_PIECE << 4));
+	for (int piece_type = PAWN; piece_type <= KING; ++piece_type) {
+		U64 pieces = m_all_pieces_bitboards[static_cast<std::size_t>(piece_type)];
+		while (pieces) {
+			int square = std::countr_zero(pieces);
+			pieces &= pieces - 1;
+			std::uint8_t& mailbox_byte = m_mailbox[static_cast<std::size_t>(square >> 1)];
+			int shift = (square & 1) << 2;
+			int piece = make_piece(piece_type, get_bit(m_white_pieces, square) != 0);
+			mailbox_byte = static_cast<std::uint8_t>((mailbox_byte & ~(0xF << shift)) | (piece << shift));
+		}
+	}
+}
+
+// This function puts the piece on the empty square.
+void Position::put_piece(int piece_type, bool white, int square) {
+	set_bit(m_all_pieces_bitboards[static_cast<std::size_t>(piece_type)], square);
+	set_bit(white ? m_white_pieces : m_black_pieces, square);
+	std::uint8_t& mailbox_byte = m_mailbox[static_cast<std::size_t>(square >> 1)];
+	int shift = (square & 1) << 2;
+	int piece = make_piece(piece_type, white);
+	mailbox_byte = static_cast<std::uint8_t>((mailbox_byte & ~(0xF << shift)) | (piece << shift));
+	m_key ^= ZOBRIST.piece_square[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	if (piece_type == PAWN)
+		m_pawn_key ^= ZOBRIST.piece_square[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	m_psq_score += PIECE_SQUARE_SCORES[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	m_phase = static_cast<std::uint8_t>(m_phase + PHASE_WEIGHTS[static_cast<std::size_t>(piece_type)]);
+}
+
+// This function removes the piece from the square.
+void Position::remove_piece(int square) {
+	int piece = piece_on(square);
+	clear_bit(m_all_pieces_bitboards[static_cast<std::size_t>(type_of_piece(piece))], square);
+	clear_bit(is_white_piece(piece) ? m_white_pieces : m_black_pieces, square);
+	std::uint8_t& mailbox_byte = m_mailbox[static_cast<std::size_t>(square >> 1)];
+	int shift = (square & 1) << 2;
+	mailbox_byte = static_cast<std::uint8_t>((mailbox_byte & ~(0xF << shift)) | (NO_PIECE << shift));
+	m_key ^= ZOBRIST.piece_square[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	if (type_of_piece(piece) == PAWN)
+		m_pawn_key ^= ZOBRIST.piece_square[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	m_psq_score -= PIECE_SQUARE_SCORES[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	m_phase = static_cast<std::uint8_t>(m_phase - PHASE_WEIGHTS[static_cast<std::size_t>(type_of_piece(piece))]);
+}
+
+// This function returns the Zobrist key of the en passant target square. It's zero if there is none or if no pawn
+// of the side to move can capture on it, so positions that only differ by an unusable en passant square get the
+// same key.
+U64 Position::en_passant_key() const {
+	if (m_en_passant_square < 0) return 0;
+	U64 own_pawns = m_all_pieces_bitboards[PAWN] & (m_active_color ? m_white_pieces : m_black_pieces);
+	// Pawns that can capture on the square are on the squares a pawn of the other color would attack from it.
+	if (!(PAWN_ATTACKS[!m_active_color][static_cast<std::size_t>(m_en_passant_square)] & own_pawns)) return 0;
+	return ZOBRIST.en_passant_file[static_cast<std::size_t>(m_en_passant_square & 7)];
+}
+
+// This function computes the Zobrist key from scratch (from the bitboards and the rest of the data).
+U64 Position::compute_key() const {
+	U64 key{};
+	for (int piece_type = PAWN; piece_type <= KING; ++piece_type) {
+		U64 pieces = m_all_pieces_bitboards[static_cast<std::size_t>(piece_type)];
+		while (pieces) {
+			int square = std::countr_zero(pieces);
+			pieces &= pieces - 1;
+			int piece = make_piece(piece_type, get_bit(m_white_pieces, square) != 0);
+			key ^= ZOBRIST.piece_square[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+		}
+	}
+	key ^= ZOBRIST.castling[m_castling_rights];
+	key ^= en_passant_key();
+	if (!m_active_color) key ^= ZOBRIST.black_to_move;
+	return key;
+}
+
+// This function computes the Zobrist key of the pawns from scratch.
+U64 Position::compute_pawn_key() const {
+	U64 key{};
+	U64 pawns = m_all_pieces_bitboards[PAWN];
+	while (pawns) {
+		int square = std::countr_zero(pawns);
+		pawns &= pawns - 1;
+		int piece = make_piece(PAWN, get_bit(m_white_pieces, square) != 0);
+		key ^= ZOBRIST.piece_square[static_cast<std::size_t>(piece)][static_cast<std::size_t>(square)];
+	}
+	return key;
+}
+
+// This function checks if neither side can mate: only kings and at most one knight or bishop are left.
+bool Position::is_insufficient_material() const {
+	if (m_all_pieces_bitboards[PAWN] | m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN]) return false;
+	return std::popcount(m_all_pieces_bitboards[KNIGHT] | m_all_pieces_bitboards[BISHOP]) <= 1;
+}
+
+// This function computes the material and piece-square score from scratch.
+Score Position::compute_psq_score() const {
+	Score score{};
+	for (int square = 0; square < 64; ++square)
+		score += PIECE_SQUARE_SCORES[static_cast<std::size_t>(piece_on(square))][static_cast<std::size_t>(square)];
+	return score;
+}
+
+// This function computes the game phase from scratch.
+int Position::compute_phase() const {
+	int phase{};
+	for (int piece_type = KNIGHT; piece_type < KING; ++piece_type)
+		phase += std::popcount(m_all_pieces_bitboards[static_cast<std::size_t>(piece_type)])
+			* PHASE_WEIGHTS[static_cast<std::size_t>(piece_type)];
+	return phase;
+}
+
+#if defined(_DEBUG) || defined(ZOBRIST_DEBUG)
+// This function stops the program if the incremental Zobrist keys or piece-square score don't match the ones
+// computed from scratch.
+void Position::check_incremental_state() const {
+	if (m_key != compute_key()) {
+		std::cerr << "Error: incremental Zobrist key " << m_key << " doesn't match the computed key " << compute_key() << '\n';
+		std::abort();
+	}
+	if (m_pawn_key != compute_pawn_key()) {
+		std::cerr << "Error: incremental pawn key " << m_pawn_key << " doesn't match the computed key "
+			<< compute_pawn_key() << '\n';
+		std::abort();
+	}
+	if (m_psq_score != compute_psq_score() || m_phase != compute_phase()) {
+		std::cerr << "Error: incremental piece-square score doesn't match the computed score" << '\n';
+		std::abort();
+	}
+}
+#endif
+
+// This function moves the piece to the empty square.
+void Position::move_piece(int move_from, int move_to) {
+	int piece = piece_on(move_from);
+	remove_piece(move_from);
+	put_piece(type_of_piece(piece), is_white_piece(piece), move_to);
+}
+
+// This function makes the move of the side to move given at compile time (see make_a_move_bitboards).
+template <bool White>
+void Position::make_move_for(Move move, UndoInfo& undo_info) {
+	int move_from = from_square(move);
+	int move_to = to_square(move);
+	int flags = move_flags(move);
+	undo_info.key = m_key;
+	undo_info.move = move;
+	undo_info.castling_rights = m_castling_rights;
+	undo_info.en_passant_square = m_en_passant_square;
+	undo_info.halfmove_clock = m_halfmove_clock;
+	undo_info.captured_piece = NO_PIECE_TYPE;
+	// The old en passant square and castling rights are XORed out of the key before they change.
+	m_key ^= en_passant_key() ^ ZOBRIST.castling[m_castling_rights];
+	// Pawn moves and captures reset the halfmove clock.
+	if (type_of_piece(piece_on(move_from)) == PAWN || is_capture(move)) m_halfmove_clock = 0;
+	else if (m_halfmove_clock < UINT8_MAX) ++m_halfmove_clock;
+	// Remove the captured piece. En passant captures the pawn behind the "move to" square.
+	if (flags == EN_PASSANT) {
+		undo_info.captured_piece = PAWN;
+		remove_piece(move_to + (White ? ONE_SQUARE_DOWN : ONE_SQUARE_UP));
+	}
+	else if (is_capture(move)) {
+		undo_info.captured_piece = static_cast<std::uint8_t>(get_bitboard(move_to));
+		remove_piece(move_to);
+	}
+	// Move the piece. If it's a promotion, the pawn is replaced by the promotion piece.
+	if (is_promotion(move)) {
+		remove_piece(move_from);
+		put_piece(promotion_piece(move), White, move_to);
+	}
+	else
+		move_piece(move_from, move_to);
+	// Castling also moves the rook (to the other side of the king).
+	if (flags == KING_CASTLE)
+		move_piece(move_to + 1, move_to - 1);
+	else if (flags == QUEEN_CASTLE)
+		move_piece(move_to - 2, move_to + 1);
+	// Moving the king or a rook (or capturing a rook) removes the castling rights.
+	m_castling_rights &= CASTLING_RIGHTS_MASK[static_cast<std::size_t>(move_from)] & CASTLING_RIGHTS_MASK[static_cast<std::size_t>(move_to)];
+	// Double pawn push sets en passant target square (the square the pawn has passed).
+	m_en_passant_square = static_cast<std::int8_t>(flags == DOUBLE_PAWN_PUSH ? (move_from + move_to) / 2 : -1);
+	// Pass the move to the other side. A new full move starts after Black's move.
+	m_active_color = !White;
+	if constexpr (!White) ++m_fullmove_number;
+	m_key ^= ZOBRIST.black_to_move ^ en_passant_key() ^ ZOBRIST.castling[m_castling_rights];
+#if defined(_DEBUG) || defined(ZOBRIST_DEBUG)
+	check_incremental_state();
+#endif
+}
+
+// This function makes a move on the bitboards and the mailbox (including castling rook moves, en passant captures
+// and promotions), updates castling rights, en passant target square and halfmove clock and passes the move to the
+// other side. The data needed to take the move back is written into undo_info.
+void Position::make_a_move_bitboards(Move move, UndoInfo& undo_info) {
+	if (m_active_color) make_move_for<true>(move, undo_info);
+	else make_move_for<false>(move, undo_info);
+}
+
+// This function takes back the move using the data saved by make_a_move_bitboards.
+void Position::unmake_a_move_bitboards(const UndoInfo& undo_info) {
+	int move_from = from_square(undo_info.move);
+	int move_to = to_square(undo_info.move);
+	int flags = move_flags(undo_info.move);
+	// Give the move back to the side that made it.
+	m_active_color = !m_active_color;
+	if (!m_active_color) --m_fullmove_number;
+	// Move the piece back. A promoted piece turns back into a pawn.
+	if (is_promotion(undo_info.move)) {
+		remove_piece(move_to);
+		put_piece(PAWN, m_active_color, move_from);
+	}
+	else
+		move_piece(move_to, move_from);
+	// Move the castling rook back.
+	if (flags == KING_CASTLE)
+		move_piece(move_to - 1, move_to + 1);
+	else if (flags == QUEEN_CASTLE)
+		move_piece(move_to + 1, move_to - 2);
+	// Put the captured piece back.
+	if (undo_info.captured_piece != NO_PIECE_TYPE) {
+		int captured_square = move_to;
+		if (flags == EN_PASSANT)
+			captured_square += m_active_color ? ONE_SQUARE_DOWN : ONE_SQUARE_UP;
+		put_piece(undo_info.captured_piece, !m_active_color, captured_square);
+	}
+	m_castling_rights = undo_info.castling_rights;
+	m_en_passant_square = undo_info.en_passant_square;
+	m_halfmove_clock = undo_info.halfmove_clock;
+	// Putting the pieces back has changed the key as well, but restoring it is cheaper than fixing the other parts.
+	m_key = undo_info.key;
+#if defined(_DEBUG) || defined(ZOBRIST_DEBUG)
+	check_incremental_state();
+#endif
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "move.h"
+#include "psqt.h"
+
+typedef uint64_t U64;
+
+// Piece types. Each value is also the number of the piece type's bitboard in m_all_pieces_bitboards (6 means there
+// is no piece).
+enum PieceType { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NO_PIECE_TYPE };
+
+// Square numbers on the bitboards (little endian rank-file mapping).
+enum Square {
+	a1, b1, c1, d1, e1, f1, g1, h1,
+	a2, b2, c2, d2, e2, f2, g2, h2,
+	a3, b3, c3, d3, e3, f3, g3, h3,
+	a4, b4, c4, d4, e4, f4, g4, h4,
+	a5, b5, c5, d5, e5, f5, g5, h5,
+	a6, b6, c6, d6, e6, f6, g6, h6,
+	a7, b7, c7, d7, e7, f7, g7, h7,
+	a8, b8, c8, d8, e8, f8, g8, h8
+};
+
+// Castling rights bits.
+enum CastlingRight { WHITE_KING_SIDE = 1, WHITE_QUEEN_SIDE = 2, BLACK_KING_SIDE = 4, BLACK_QUEEN_SIDE = 8 };
+constexpr std::uint8_t ALL_CASTLING_RIGHTS{ 15 };
+
+// Longest FEN a position can have: 64 pieces and 7 slashes, then " w KQkq e3 255 65535".
+constexpr std::size_t MAX_FEN_LENGTH{ 91 };
+
+// Kinds of moves a move generator writes: all of them, only captures and promotions or only quiet moves (the other
+// moves, castling included).
+enum GenerationType { GENERATE_ALL, GENERATE_CAPTURES, GENERATE_QUIETS };
+
+// The fifty-move rule draws the game after this many plies without a capture or a pawn move.
+constexpr int FIFTY_MOVE_RULE_PLIES{ 100 };
+
+// Pieces in the mailbox: the piece type in the lower 3 bits and the color in bit 3 (set for black). An empty square
+// holds NO_PIECE_TYPE.
+constexpr int BLACK_PIECE_BIT{ 8 };
+constexpr int NO_PIECE{ NO_PIECE_TYPE };
+constexpr int make_piece(int piece_type, bool white) { return piece_type | (white ? 0 : BLACK_PIECE_BIT); }
+constexpr int type_of_piece(int piece) { return piece & 7; }
+constexpr bool is_white_piece(int piece) { return (piece & BLACK_PIECE_BIT) == 0; }
+
+// Data needed to take a move back: everything that can't be recomputed from the move itself.
+struct UndoInfo {
+	U64 key;								// Zobrist key before the move.
+	Move move;
+	std::uint8_t captured_piece;			// Piece type of the captured piece (NO_PIECE_TYPE if it wasn't a capture).
+	std::uint8_t castling_rights;			// Castling rights before the move.
+	std::int8_t en_passant_square;			// En passant target square before the move (-1 if there was none).
+	std::uint8_t halfmove_clock;			// Halfmove clock before the move.
+};
+
+// Core board state: bitboards, piece-on-square mailbox and the rest of the FEN data. It's trivially copyable and fits
+// into two cache lines, so search threads can keep and copy positions cheaply.
+class Position {
+protected:
+	static constexpr U64 EMPTY_BITBOARD{ 0x00000000000000ULL };
+	static constexpr U64 A_FILE{ 0x0101010101010101ULL };
+	static constexpr U64 A_B_FILES{ 0x0303030303030303ULL };
+	static constexpr U64 H_FILE{ 0x8080808080808080ULL };
+	static constexpr U64 G_H_FILES{ 0xC0C0C0C0C0C0C0C0ULL };
+	static constexpr U64 RANK_8{ 0xFF00000000000000ULL };
+	static constexpr U64 RANKS_7_8{ 0xFFFF000000000000ULL };
+	static constexpr U64 RANK_1{ 0xFFULL };
+	static constexpr U64 RANKS_1_2{ 0xFFFFULL };
+	static constexpr U64 RANK_2{ 0xFF00ULL };
+	static constexpr U64 RANK_7{ 0xFF000000000000ULL };
+
+	// Squares on the bitboard relative to current square.
+	static constexpr int ONE_SQUARE_UP{ 8 };
+	static constexpr int ONE_SQUARE_DOWN{ -8 };
+	static constexpr int TWO_SQUARES_UP{ 16 };
+	static constexpr int TWO_SQUARES_DOWN{ -16 };
+	static constexpr int ONE_SQUARE_LEFT_ONE_UP{ 7 };
+	static constexpr int ONE_SQUARE_RIGHT_ONE_UP{ 9 };
+	static constexpr int ONE_SQUARE_LEFT_ONE_DOWN{ -9 };
+	static constexpr int ONE_SQUARE_RIGHT_ONE_DOWN{ -7 };
+
+	// Squares that have to be empty between the king and the rook for castling.
+	static constexpr U64 WHITE_KING_CASTLING_EMPTY{ 0x60ULL };
+	static constexpr U64 WHITE_QUEEN_CASTLING_EMPTY{ 0xEULL };
+	static constexpr U64 BLACK_KING_CASTLING_EMPTY{ 0x6000000000000000ULL };
+	static constexpr U64 BLACK_QUEEN_CASTLING_EMPTY{ 0xE00000000000000ULL };
+
+	// Castling rights that stay after a move from or to the square (moving the king or a rook, or capturing a rook,
+	// removes them).
+	static constexpr std::array<std::uint8_t, 64> CASTLING_RIGHTS_MASK = [] {
+		std::array<std::uint8_t, 64> mask{};
+		mask.fill(ALL_CASTLING_RIGHTS);
+		mask[e1] = static_cast<std::uint8_t>(ALL_CASTLING_RIGHTS & ~(WHITE_KING_SIDE | WHITE_QUEEN_SIDE));
+		mask[h1] = static_cast<std::uint8_t>(ALL_CASTLING_RIGHTS & ~WHITE_KING_SIDE);
+		mask[a1] = static_cast<std::uint8_t>(ALL_CASTLING_RIGHTS & ~WHITE_QUEEN_SIDE);
+		mask[e8] = static_cast<std::uint8_t>(ALL_CASTLING_RIGHTS & ~(BLACK_KING_SIDE | BLACK_QUEEN_SIDE));
+		mask[h8] = static_cast<std::uint8_t>(ALL_CASTLING_RIGHTS & ~BLACK_KING_SIDE);
+		mask[a8] = static_cast<std::uint8_t>(ALL_CASTLING_RIGHTS & ~BLACK_QUEEN_SIDE);
+		return mask;
+	}();
+
+	// Bitboards for board data: one per piece type (both colors) and one per color.
+	std::array<U64, 6> m_all_pieces_bitboards{};
+	U64 m_white_pieces{};
+	U64 m_black_pieces{};
+
+	// Zobrist key of the position, updated with every change of the board and the other data.
+	U64 m_key{};
+
+	// Zobrist key of the pawns of both colors alone (the key of the pawn structure), updated with every pawn put on or
+	// removed from the board.
+	U64 m_pawn_key{};
+
+	// Material and piece-square score (from White's point of view) and game phase, updated with every piece put on or
+	// removed from the board.
+	Score m_psq_score{};
+	std::uint8_t m_phase{};
+
+	// Piece on every square, two squares per byte (lower nibble - even square, upper nibble - odd square).
+	std::array<std::uint8_t, 32> m_mailbox{};
+
+	// Values for additional data.
+	bool m_active_color{};							// true - white, false - black.
+	std::uint8_t m_castling_rights{};
+	std::int8_t m_en_passant_square{ -1 };			// -1 if there is no en passant target square.
+	std::uint8_t m_halfmove_clock{};
+	std::uint16_t m_fullmove_number{};
+
+	// This function puts the piece on the empty square.
+	void put_piece(int piece_type, bool white, int square);
+
+	// This function removes the piece from the square.
+	void remove_piece(int square);
+
+	// This function moves the piece to the empty square.
+	void move_piece(int move_from, int move_to);
+
+	// This function fills the mailbox from the bitboards.
+	void fill_mailbox();
+
+	// This function adds the pushes, captures and promotions of the pawns that land on the target squares (en passant
+	// captures aren't included).
+	void generate_pawn_moves(MoveList& move_list, U64 pawns, U64 targets) const;
+
+	// This function adds the pawn moves of the generation type that land on the target squares (en passant captures
+	// aren't included). Directions and ranks of the color are compile-time constants.
+	template <bool White, GenerationType Type>
+	void generate_pawn_moves_for(MoveList& move_list, U64 pawns, U64 targets) const;
+
+	// This function writes the legal moves of the generation type into the move list, for the side to move given at
+	// compile time.
+	template <bool White, GenerationType Type>
+	void generate_legal_moves_for(MoveList& move_list) const;
+
+	// This function makes the move of the side to move given at compile time (see make_a_move_bitboards).
+	template <bool White>
+	void make_move_for(Move move, UndoInfo& undo_info);
+
+	// This function returns the Zobrist key of the en passant target square. It's zero if there is none or if no pawn
+	// of the side to move can capture on it, so positions that only differ by an unusable en passant square get the
+	// same key.
+	U64 en_passant_key() const;
+
+#if defined(_DEBUG) || defined(ZOBRIST_DEBUG)
+	// This function stops the program if the incremental Zobrist keys or piece-square score don't match the ones
+	// computed from scratch.
+	void check_incremental_state() const;
+#endif
+
+public:
+	Position() = default;
+
+	Position(std::array<U64, 6> all_pieces_bitboards, U64 white_pieces, U64 black_pieces, bool active_color,
+		std::uint8_t castling_rights, int en_passant_square, int halfmove_clock, int fullmove_number);
+
+	// This function sets the position from the FEN string in one pass, without copying the string or allocating
+	// memory. The halfmove clock and the fullmove number may be left out (as in EPD), they are 0 and 1 then. Returns
+	// nullptr if the FEN is a valid position, otherwise a description of the error (the position is unusable then).
+	const char* set_fen(std::string_view fen);
+
+	// This function checks that the position can occur in a game as far as the search relies on it: one king per side,
+	// no pawns on the 1st or the 8th rank, the side that is not to move isn't in check, every castling right has the
+	// king and the rook on their starting squares and the en passant target square follows a pawn's double step.
+	// Returns nullptr if it does, otherwise a description of the error.
+	const char* check_rules() const;
+
+	// This function writes the FEN of the position into the buffer (at least MAX_FEN_LENGTH characters, no terminating
+	// zero) in one pass over the ranks and returns its length.
+	std::size_t write_fen(char* buffer) const;
+
+	// This function returns the FEN of the position.
+	std::string get_fen() const;
+
+	// This function returns the piece on the square (NO_PIECE if it's empty).
+	int piece_on(int square) const {
+		return (m_mailbox[static_cast<std::size_t>(square >> 1)] >> ((square & 1) << 2)) & 0xF;
+	}
+
+	// Function that gets bitboard that has a piece in a particular field (NO_PIECE_TYPE if the square is empty).
+	std::size_t get_bitboard(int square) const { return static_cast<std::size_t>(type_of_piece(piece_on(square))); }
+
+	// This function returns the bitboard of the piece type (both colors).
+	U64 get_pieces(int piece_type) const { return m_all_pieces_bitboards[static_cast<std::size_t>(piece_type)]; }
+
+	// This function returns the bitboard with the pieces of the color.
+	U64 get_color_pieces(bool white) const { return white ? m_white_pieces : m_black_pieces; }
+
+	// This function returns the bitboard with all the pieces.
+	U64 get_occupied() const { return m_white_pieces | m_black_pieces; }
+
+	// This function returns the bitboard with the pieces of the side to move.
+	U64 get_own_pieces() const { return m_active_color ? m_white_pieces : m_black_pieces; }
+
+	// This function returns the bitboard with the pieces of the side that is not to move.
+	U64 get_opponent_pieces() const { return m_active_color ? m_black_pieces : m_white_pieces; }
+
+	// These functions return the rest of the FEN data.
+	bool get_active_color() const { return m_active_color; }
+	std::uint8_t get_castling_rights() const { return m_castling_rights; }
+	int get_en_passant_square() const { return m_en_passant_square; }
+	int get_halfmove_clock() const { return m_halfmove_clock; }
+	int get_fullmove_number() const { return m_fullmove_number; }
+
+	// This function returns the Zobrist key of the position.
+	U64 get_key() const { return m_key; }
+
+	// This function checks if neither side can mate: only kings and at most one knight or bishop are left.
+	bool is_insufficient_material() const;
+
+	// This function computes the Zobrist key from scratch (from the bitboards and the rest of the data).
+	U64 compute_key() const;
+
+	// This function returns the Zobrist key of the pawns.
+	U64 get_pawn_key() const { return m_pawn_key; }
+
+	// This function computes the Zobrist key of the pawns from scratch.
+	U64 compute_pawn_key() const;
+
+	// This function returns the material and piece-square score from White's point of view.
+	Score get_psq_score() const { return m_psq_score; }
+
+	// This function returns the game phase (MAX_PHASE or more with all pieces on the board, 0 with only pawns and kings).
+	int get_phase() const { return m_phase; }
+
+	// These functions compute the material and piece-square score and the game phase from scratch.
+	Score compute_psq_score() const;
+	int compute_phase() const;
+
+	// This function returns the square of the king of the selected color.
+	int get_king_square(bool white) const;
+
+	// This function checks if the square is attacked by the pieces of the selected color.
+	bool is_square_attacked(int square, bool by_white) const;
+
+	// This function returns the pieces of both colors that attack the square when the occupied squares are the given
+	// ones (so pieces can be removed or added for the test).
+	U64 attackers_to(int square, U64 occupied) const;
+
+	// This function checks if the king of the side to move is in check.
+	bool is_in_check() const;
+
+	// This function returns the opponent's pieces that give check to the king of the side to move.
+	U64 get_checkers() const;
+
+	// This function returns the pieces of the side to move that are pinned to their king: the only piece between the
+	// king and an opponent's slider on the same line.
+	U64 get_pinned_pieces() const;
+
+	// This function writes all pseudo-legal moves (moves that may leave own king in check) into the move list.
+	void generate_pseudo_legal_moves(MoveList& move_list) const;
+
+	// This function writes all legal moves of the side to move into the move list. The moves are generated legal: in
+	// check only the king moves or the checker is captured or blocked, and pinned pieces only move along the pin.
+	void generate_legal_moves(MoveList& move_list) const;
+
+	// This function writes the legal captures and promotions of the side to move into the move list.
+	void generate_legal_captures(MoveList& move_list) const;
+
+	// This function writes the legal quiet moves (no captures or promotions) of the side to move into the move list.
+	void generate_legal_quiets(MoveList& move_list) const;
+
+	// Runtime color version of generate_legal_moves, kept to compare the color templates with (bench movegen).
+	void generate_legal_moves_runtime(MoveList& move_list) const;
+
+	// This function checks if the move (possibly from another position, like a hash or killer move) is pseudo-legal
+	// here: it has to be one of the moves generate_pseudo_legal_moves would write. is_legal has to be checked too.
+	bool is_pseudo_legal(Move move) const;
+
+	// This function checks that the pseudo-legal move doesn't leave own king in check. The move isn't made, the attacks
+	// on the king are computed with the occupancy after the move.
+	bool is_legal(Move move) const;
+
+	// This function checks if the static exchange evaluation of the move is at least the threshold: the material won
+	// when both sides keep recapturing on the "move to" square with their least valuable attacker (x-rays included)
+	// until one of them is better off stopping. No move is made.
+	bool see(Move move, int threshold) const;
+
+	// This function makes a move on the bitboards and the mailbox (including castling rook moves, en passant captures
+	// and promotions), updates castling rights, en passant target square and halfmove clock and passes the move to the
+	// other side. The data needed to take the move back is written into undo_info.
+	void make_a_move_bitboards(Move move, UndoInfo& undo_info);
+
+	// This function takes back the move using the data saved by make_a_move_bitboards.
+	void unmake_a_move_bitboards(const UndoInfo& undo_info);
+};
+
+// This function returns the FEN part of the line: the first four fields and the counters if they follow (EPD lines
+// have operations like "bm e4;" there instead).
+std::string_view fen_of_line(std::string_view line);
+
+static_assert(std::is_trivially_copyable_v<Position>, "Position has to be trivially copyable.");
+static_assert(sizeof(Position) <= 128, "Position has to fit into two cache lines.");
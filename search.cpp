@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "evaluate.h"
+#include "movepick.h"
+#include "nnue.h"
+#include "search.h"
+#include "timeman.h"
+#include "tt.h"
+
+// Set by stop_search and cleared by clear_stop_request, checked by all search threads.
+static std::atomic<bool> stop_requested{};
+
+// While it's set, the search ignores its time limit (the engine is thinking on the opponent's time).
+static std::atomic<bool> pondering{};
+
+// Number of threads used by the next search.
+static std::size_t search_thread_count{ 1 };
+
+// Node count of one search thread, published every STOP_CHECK_INTERVAL nodes so the main thread can report the total.
+// Every counter has its own cache line, so the threads don't slow each other down writing them.
+struct alignas(64) NodeCounter {
+	std::atomic<std::uint64_t> nodes{};
+};
+
+// Data shared by the threads of one search. Every search has its own, so searches running at the same time (batch
+// mode, self-play games) don't stop each other.
+struct SharedSearchData {
+	TranspositionTable& table;
+	std::vector<NodeCounter> node_counters;
+	// Set by the main thread when it's done, to stop the helper threads.
+	std::atomic<bool> helpers_stop{};
+};
+
+// This function returns the search thread data of the calling thread, used when it's the main thread of a search and
+// no other data is given.
+static SearchThreadData& caller_thread_data() {
+	thread_local std::unique_ptr<SearchThreadData> data = std::make_unique<SearchThreadData>();
+	return *data;
+}
+
+// Data of the helper threads, by helper index (thread index - 1). The helpers are new threads in every search, so
+// their data is kept here. Only one search at a time uses more than one thread (batch mode and self-play use one
+// thread per search), so searches that run at the same time never share it.
+static std::vector<std::unique_ptr<SearchThreadData>> helper_thread_data{};
+
+// Helper threads skip some iterations, so at any time they are spread over different depths and fill the shared
+// transposition table with results the other threads can use. Helper i skips the depths where
+// ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) is odd (i is taken modulo 20).
+static constexpr std::array<int, 20> SKIP_SIZE{ 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static constexpr std::array<int, 20> SKIP_PHASE{ 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// History bonus of a quiet move that caused a beta cutoff at the depth (and the penalty of the quiet moves searched
+// before it) grows with the square of the depth, up to this limit.
+static constexpr int MAX_HISTORY_BONUS{ 2048 };
+
+// How often (in nodes) the search checks the time, the node limit and the stop request. At about a million nodes per
+// second that's every millisecond, which is often enough even for the hard deadline of a bullet game.
+static constexpr std::uint64_t STOP_CHECK_INTERVAL{ 1024 };
+
+// Mate scores in the transposition table are stored as the distance from the stored position, not from the root.
+static int score_to_tt(int score, int ply) {
+	if (score >= MATE_IN_MAX_PLY) return score + ply;
+	if (score <= -MATE_IN_MAX_PLY) return score - ply;
+	return score;
+}
+
+static int score_from_tt(int score, int ply) {
+	if (score >= MATE_IN_MAX_PLY) return score - ply;
+	if (score <= -MATE_IN_MAX_PLY) return score + ply;
+	return score;
+}
+
+// Search of one thread. It searches its own copy of the game, so it can make and unmake moves freely. Thread 0 is the
+// main thread, the others are helpers that only fill the shared transposition table.
+class Searcher {
+	GameData m_game_data;
+	SearchLimits m_limits;
+	std::chrono::steady_clock::time_point m_start;
+	std::size_t m_thread_index;
+	SharedSearchData& m_shared;
+	// Only the main thread keeps to the time limits, the helpers are stopped by it.
+	TimeManager m_time_manager;
+	bool m_pondering;
+	std::uint64_t m_nodes{};
+	// The first iteration always finishes, so there is always a move to play.
+	bool m_can_stop{};
+	bool m_stopped{};
+
+	// Triangular principal variation table: m_pv[ply] holds the best line found from that ply.
+	std::array<std::array<Move, MAX_PLY + 1>, MAX_PLY + 1> m_pv{};
+	std::array<int, MAX_PLY + 1> m_pv_length{};
+
+	// The network evaluates the positions if one is loaded, with the accumulators of the searched line. Otherwise the
+	// classical evaluation takes the pawn structure from the thread's pawn hash table.
+	bool m_use_network;
+	AccumulatorStack m_accumulators{ MAX_PLY };
+	SearchThreadData& m_thread_data;
+
+	// Move ordering: two killer moves per ply (quiet moves that caused a beta cutoff at the same ply, only useful within
+	// one search, as the plies are counted from its root) and the history of the quiet moves, kept by the thread.
+	std::array<std::array<Move, 2>, MAX_PLY + 1> m_killers{};
+	SearchHistory& m_history;
+
+	// This function returns the time since the start of the search in milliseconds.
+	std::int64_t elapsed_ms() const {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+	// This function starts the clock when pondering turns into a normal search ("ponderhit").
+	void update_pondering() {
+		if (m_pondering && !pondering.load(std::memory_order_relaxed)) {
+			m_pondering = false;
+			m_time_manager.restart(std::chrono::steady_clock::now());
+		}
+	}
+
+	// This function checks the limits every STOP_CHECK_INTERVAL nodes. Returns true if the search has to stop.
+	bool should_stop() {
+		if (m_stopped) return true;
+		if (!m_can_stop || m_nodes % STOP_CHECK_INTERVAL != 0) return false;
+		m_shared.node_counters[m_thread_index].nodes.store(m_nodes, std::memory_order_relaxed);
+		bool time_up{};
+		if (m_thread_index == 0) {
+			update_pondering();
+			time_up = !m_pondering && m_time_manager.hard_limit_reached();
+		}
+		m_stopped = time_up || stop_requested.load(std::memory_order_relaxed)
+			|| m_shared.helpers_stop.load(std::memory_order_relaxed)
+			|| (m_limits.nodes && total_nodes() >= m_limits.nodes);
+		return m_stopped;
+	}
+
+	// This function evaluates the position at the ply.
+	int evaluate_node(int ply) {
+		return m_use_network ? m_accumulators.evaluate(m_game_data, ply) : evaluate(m_game_data, nullptr, &m_thread_data.pawn_table);
+	}
+
+	// This function makes the move in the position at the ply.
+	void make_move(Move move, int ply) {
+		if (m_use_network) m_accumulators.push_move(m_game_data, move, ply);
+		m_game_data.make_move(move);
+	}
+
+	// This function returns the piece and the "move to" square of the last move, the index of the continuation
+	// history (NO_PIECE on a1 if there is none).
+	std::pair<int, int> previous_move_index() const {
+		Move previous = m_game_data.get_last_move();
+		if (previous == NO_MOVE) return { NO_PIECE, a1 };
+		return { m_game_data.piece_on(to_square(previous)), to_square(previous) };
+	}
+
+	// This function rewards the quiet move that caused a beta cutoff: it becomes the first killer of the ply and the
+	// counter move of the previous move, and its history grows. The history of the quiet moves searched before it
+	// shrinks.
+	void update_quiet_history(Move move, int depth, int ply, const MoveList& quiets_searched) {
+		std::array<Move, 2>& killers = m_killers[static_cast<std::size_t>(ply)];
+		if (killers[0] != move) {
+			killers[1] = killers[0];
+			killers[0] = move;
+		}
+		auto [previous_piece, previous_to] = previous_move_index();
+		if (m_game_data.get_last_move() != NO_MOVE)
+			m_history.counter_moves[static_cast<std::size_t>(previous_piece)][static_cast<std::size_t>(previous_to)] = move;
+		auto& butterfly = m_history.butterfly[m_game_data.get_active_color()];
+		auto& continuation = m_history.continuation[static_cast<std::size_t>(previous_piece)]
+			[static_cast<std::size_t>(previous_to)];
+		int bonus = std::min(depth * depth * 16, MAX_HISTORY_BONUS);
+		for (Move quiet : quiets_searched) {
+			std::size_t move_from = static_cast<std::size_t>(from_square(quiet));
+			std::size_t move_to = static_cast<std::size_t>(to_square(quiet));
+			std::size_t piece = static_cast<std::size_t>(m_game_data.piece_on(from_square(quiet)));
+			int quiet_bonus = quiet == move ? bonus : -bonus;
+			SearchHistory::update(butterfly[move_from][move_to], quiet_bonus);
+			SearchHistory::update(continuation[piece][move_to], quiet_bonus);
+		}
+	}
+
+	// This function saves the move followed by the principal variation of the next ply as the line of this ply.
+	void update_pv(int ply, Move move) {
+		std::size_t current = static_cast<std::size_t>(ply);
+		m_pv[current][0] = move;
+		for (int i = 0; i < m_pv_length[current + 1]; ++i)
+			m_pv[current][static_cast<std::size_t>(i + 1)] = m_pv[current + 1][static_cast<std::size_t>(i)];
+		m_pv_length[current] = m_pv_length[current + 1] + 1;
+	}
+
+	// This function searches only captures and promotions (all moves when in check) until the position is quiet, so
+	// the evaluation isn't taken in the middle of an exchange.
+	int quiescence(int alpha, int beta, int ply) {
+		++m_nodes;
+		m_pv_length[static_cast<std::size_t>(ply)] = 0;
+		if (should_stop()) return 0;
+		bool in_check = m_game_data.is_in_check();
+		if (ply >= MAX_PLY) return in_check ? 0 : evaluate_node(ply);
+		// Standing pat: the side to move can usually do at least as well as the static evaluation by not capturing.
+		// In check every evasion has to be searched.
+		int best_score = -INFINITE_SCORE;
+		if (!in_check) {
+			best_score = evaluate_node(ply);
+			if (best_score >= beta) return best_score;
+			alpha = std::max(alpha, best_score);
+		}
+		// Out of check only captures and promotions are searched, and not the ones that lose material by the static
+		// exchange evaluation: standing pat is at least as good.
+		MovePicker picker{ m_game_data, m_history, in_check };
+		int moves_searched{};
+		for (Move move = picker.next_move(); move != NO_MOVE; move = picker.next_move()) {
+			++moves_searched;
+			make_move(move, ply);
+			int score = -quiescence(-beta, -alpha, ply + 1);
+			m_game_data.unmake_move();
+			if (m_stopped) return 0;
+			if (score > best_score) {
+				best_score = score;
+				if (score > alpha) {
+					alpha = score;
+					update_pv(ply, move);
+					if (score >= beta) break;
+				}
+			}
+		}
+		if (in_check && moves_searched == 0) return -MATE_SCORE + ply;
+		return best_score;
+	}
+
+	// This function is the principal variation search: the first move is searched with the full window, the others
+	// with a null window around alpha, and they are searched again only if they turn out to be better.
+	int alpha_beta(int alpha, int beta, int depth, int ply) {
+		std::size_t current = static_cast<std::size_t>(ply);
+		m_pv_length[current] = 0;
+		bool pv_node = beta - alpha > 1;
+		if (ply > 0) {
+			// Fifty-move rule and repetitions. One repetition is enough to call it a draw: if it was the best line
+			// once, it's the best line again.
+			if (m_game_data.get_halfmove_clock() >= FIFTY_MOVE_RULE_PLIES || m_game_data.is_repetition(1)) return 0;
+			// Mate distance pruning: no line from here can be better than mating at this ply or worse than being mated.
+			alpha = std::max(alpha, -MATE_SCORE + ply);
+			beta = std::min(beta, MATE_SCORE - ply - 1);
+			if (alpha >= beta) return alpha;
+		}
+		bool in_check = m_game_data.is_in_check();
+		// Check extension: don't drop into the quiescence search while in check.
+		if (in_check) ++depth;
+		if (depth <= 0 || ply >= MAX_PLY) return quiescence(alpha, beta, ply);
+		++m_nodes;
+		if (should_stop()) return 0;
+
+		U64 key = m_game_data.get_key();
+		TTData tt_data{};
+		bool tt_hit = m_shared.table.probe(key, tt_data);
+		Move hash_move = tt_hit ? tt_data.move : NO_MOVE;
+		if (tt_hit && !pv_node && tt_data.depth >= depth) {
+			int tt_score = score_from_tt(tt_data.score, ply);
+			if (tt_data.bound == BOUND_EXACT || (tt_data.bound == BOUND_LOWER && tt_score >= beta)
+				|| (tt_data.bound == BOUND_UPPER && tt_score <= alpha))
+				return tt_score;
+		}
+
+		auto [previous_piece, previous_to] = previous_move_index();
+		Move counter_move = m_game_data.get_last_move() == NO_MOVE ? NO_MOVE
+			: m_history.counter_moves[static_cast<std::size_t>(previous_piece)][static_cast<std::size_t>(previous_to)];
+		const std::array<Move, 2>& killers = m_killers[current];
+		MovePicker picker{ m_game_data, m_history, hash_move, killers[0], killers[1], counter_move, previous_piece,
+			previous_to };
+
+		int original_alpha = alpha;
+		int best_score = -INFINITE_SCORE;
+		Move best_move = NO_MOVE;
+		int moves_searched{};
+		// Quiet moves searched so far, to lower their history if a later quiet move causes the cutoff.
+		MoveList quiets_searched;
+		for (Move move = picker.next_move(); move != NO_MOVE; move = picker.next_move()) {
+			bool quiet = !is_capture(move) && !is_promotion(move);
+			if (quiet) quiets_searched.push_back(move);
+			make_move(move, ply);
+			int score{};
+			if (moves_searched++ == 0)
+				score = -alpha_beta(-beta, -alpha, depth - 1, ply + 1);
+			else {
+				score = -alpha_beta(-alpha - 1, -alpha, depth - 1, ply + 1);
+				if (score > alpha && score < beta)
+					score = -alpha_beta(-beta, -alpha, depth - 1, ply + 1);
+			}
+			m_game_data.unmake_move();
+			if (m_stopped) return 0;
+			if (score > best_score) {
+				best_score = score;
+				best_move = move;
+				if (score > alpha) {
+					alpha = score;
+					update_pv(ply, move);
+					if (score >= beta) {
+						if (quiet) update_quiet_history(move, depth, ply, quiets_searched);
+						break;
+					}
+				}
+			}
+		}
+		// No legal moves: checkmate or stalemate.
+		if (moves_searched == 0) return in_check ? -MATE_SCORE + ply : 0;
+
+		Bound bound = best_score >= beta ? BOUND_LOWER : best_score > original_alpha ? BOUND_EXACT : BOUND_UPPER;
+		m_shared.table.store(key, best_move, score_to_tt(best_score, ply), depth, bound);
+		return best_score;
+	}
+
+	// This function returns the node count of all threads.
+	std::uint64_t total_nodes() const {
+		std::uint64_t nodes{};
+		for (const NodeCounter& counter : m_shared.node_counters)
+			nodes += counter.nodes.load(std::memory_order_relaxed);
+		return nodes;
+	}
+
+public:
+	Searcher(const GameData& game_data, const SearchLimits& limits, std::chrono::steady_clock::time_point start,
+		std::size_t thread_index, SharedSearchData& shared, SearchThreadData& thread_data)
+		: m_game_data{ game_data }
+		, m_limits{ limits }
+		, m_start{ start }
+		, m_thread_index{ thread_index }
+		, m_shared{ shared }
+		, m_time_manager{ limits, game_data.get_active_color(), start }
+		, m_pondering{ pondering.load() }
+		// Helpers don't have to finish the first iteration.
+		, m_can_stop{ thread_index != 0 }
+		, m_use_network{ network_loaded() }
+		, m_thread_data{ thread_data }
+		, m_history{ thread_data.history }
+	{
+		if (m_use_network) m_accumulators.reset(m_game_data);
+	}
+
+	// This function searches with increasing depth until a limit is reached and returns the result of the last
+	// completed iteration.
+	SearchResult iterative_deepening(bool print_info) {
+		SearchResult result{};
+		MoveList root_moves;
+		m_game_data.generate_legal_moves(root_moves);
+		if (root_moves.empty()) {
+			result.score = m_game_data.is_in_check() ? -MATE_SCORE : 0;
+			if (print_info)
+				std::cout << "info depth 0 score " + (result.score ? std::string{ "mate 0" } : score_to_string(0)) + '\n'
+					<< std::flush;
+			return result;
+		}
+		// Number of iterations in a row with the same best move.
+		int best_move_stability{};
+		for (int depth = 1; depth <= std::min(m_limits.depth, MAX_PLY - 1); ++depth) {
+			if (m_thread_index > 0) {
+				std::size_t skip_index = (m_thread_index - 1) % SKIP_SIZE.size();
+				if ((depth + SKIP_PHASE[skip_index]) / SKIP_SIZE[skip_index] % 2) continue;
+			}
+			int score = alpha_beta(-INFINITE_SCORE, INFINITE_SCORE, depth, 0);
+			m_shared.node_counters[m_thread_index].nodes.store(m_nodes, std::memory_order_relaxed);
+			if (m_stopped) break;
+			m_can_stop = true;
+			best_move_stability = m_pv[0][0] == result.best_move ? best_move_stability + 1 : 0;
+			int score_drop = depth > 1 ? result.score - score : 0;
+			result.best_move = m_pv[0][0];
+			result.score = score;
+			result.depth = depth;
+			result.principal_variation.assign(m_pv[0].begin(), m_pv[0].begin() + m_pv_length[0]);
+			result.nodes = m_nodes;
+			result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+			if (print_info) {
+				std::int64_t time_ms = elapsed_ms();
+				std::uint64_t nodes = total_nodes();
+				std::ostringstream info;
+				info << "info depth " << depth << " score " << score_to_string(score) << " nodes " << nodes
+					<< " nps " << nodes * 1000 / static_cast<std::uint64_t>(std::max<std::int64_t>(time_ms, 1))
+					<< " time " << time_ms << " hashfull " << m_shared.table.hashfull() << " pv";
+				for (Move move : result.principal_variation)
+					info << ' ' << move_to_string(move);
+				// One write per line, so lines printed by other threads (the UCI loop) don't get mixed in.
+				info << '\n';
+				std::cout << info.str() << std::flush;
+			}
+			// A mate found within the depth can't be improved by searching deeper.
+			if (std::abs(score) >= MATE_IN_MAX_PLY && MATE_SCORE - std::abs(score) <= depth) break;
+			if (m_thread_index == 0) {
+				update_pondering();
+				if (!m_pondering && !m_time_manager.start_next_iteration(best_move_stability, score_drop)) break;
+			}
+		}
+		result.nodes = m_nodes;
+		result.pawn_table_probes = m_thread_data.pawn_table.probes();
+		result.pawn_table_hits = m_thread_data.pawn_table.hits();
+		return result;
+	}
+};
+
+// This function searches the position with iterative deepening principal variation search and returns the best move.
+// With print_info it prints a UCI "info" line after every iteration (depth, score, nodes, speed and principal
+// variation). With more than one thread it's a Lazy SMP search: the helper threads search the same position and
+// share what they find through the transposition table, and the main thread's result is returned. The main thread
+// uses the given thread data or, without it, the calling thread's own. The helpers' data is shared by all searches, so
+// a search with more than one thread must not run at the same time as any other search.
+SearchResult search(const GameData& game_data, const SearchLimits& limits, bool print_info, TranspositionTable& table,
+	SearchThreadData* thread_data) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	table.new_search();
+	std::size_t thread_count = search_thread_count;
+	SharedSearchData shared{ table, std::vector<NodeCounter>(thread_count) };
+	// Every thread allocates its own searcher (the game copy and the per-ply tables) and its thread data the first time
+	// it's needed, so the memory is first touched, and placed, by the thread that uses it.
+	if (helper_thread_data.size() < thread_count - 1) helper_thread_data.resize(thread_count - 1);
+	std::vector<std::thread> helpers{};
+	for (std::size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+		helpers.emplace_back([&game_data, &limits, &shared, start, thread_index] {
+			std::unique_ptr<SearchThreadData>& helper_data = helper_thread_data[thread_index - 1];
+			if (!helper_data) helper_data = std::make_unique<SearchThreadData>();
+			std::unique_ptr<Searcher> helper = std::make_unique<Searcher>(game_data, limits, start, thread_index, shared,
+				*helper_data);
+			helper->iterative_deepening(false);
+		});
+	}
+	std::unique_ptr<Searcher> searcher = std::make_unique<Searcher>(game_data, limits, start, 0, shared,
+		thread_data ? *thread_data : caller_thread_data());
+	SearchResult result = searcher->iterative_deepening(print_info);
+	// The main thread decides when the search is over.
+	shared.helpers_stop = true;
+	for (std::thread& helper : helpers)
+		helper.join();
+	result.nodes = 0;
+	for (const NodeCounter& counter : shared.node_counters) {
+		result.thread_nodes.push_back(counter.nodes.load());
+		result.nodes += result.thread_nodes.back();
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+// This function clears the move ordering history of the thread data (the calling thread's without it) and of the
+// helper threads before a new game, so the search doesn't depend on the games played before.
+void clear_search_history(SearchThreadData* thread_data) {
+	(thread_data ? *thread_data : caller_thread_data()).history.clear();
+	for (std::unique_ptr<SearchThreadData>& helper_data : helper_thread_data)
+		if (helper_data) helper_data->history.clear();
+}
+
+// This function sets the number of threads used by the next search (at least 1).
+void set_search_threads(std::size_t thread_count) {
+	search_thread_count = std::clamp<std::size_t>(thread_count, 1, MAX_SEARCH_THREADS);
+}
+
+// This function returns the number of threads used by the next search.
+std::size_t get_search_threads() {
+	return search_thread_count;
+}
+
+// This function asks the running search to stop. The search then returns the result of the last completed iteration.
+// The request stays until clear_stop_request is called, so a request made just before the search starts isn't lost.
+void stop_search() {
+	stop_requested = true;
+}
+
+// This function clears the stop request before a new search.
+void clear_stop_request() {
+	stop_requested = false;
+}
+
+// This function turns pondering on or off. While pondering, the search doesn't stop because of its time limit.
+void set_pondering(bool ponder) {
+	pondering = ponder;
+}
+
+// This function converts the score into the UCI form ("cp 25" or "mate -3", mate in moves, not plies).
+std::string score_to_string(int score) {
+	if (score >= MATE_IN_MAX_PLY) return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+	if (score <= -MATE_IN_MAX_PLY) return "mate " + std::to_string(-(MATE_SCORE + score) / 2);
+	return "cp " + std::to_string(score);
+}
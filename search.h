@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game_class.h"
+#include "move.h"
+#include "movepick.h"
+#include "pawns.h"
+#include "tt.h"
+
+// Maximum search depth in plies (also the size of the per-ply search tables).
+constexpr int MAX_PLY{ 128 };
+
+// Maximum number of search threads.
+constexpr std::size_t MAX_SEARCH_THREADS{ 1024 };
+
+// Mate scores are MATE_SCORE minus the distance to the mate in plies, so shorter mates score higher.
+constexpr int MATE_SCORE{ 32000 };
+constexpr int INFINITE_SCORE{ 32001 };
+constexpr int MATE_IN_MAX_PLY{ MATE_SCORE - MAX_PLY };
+
+// Time kept in reserve for the communication with the GUI by default (in milliseconds).
+constexpr std::int64_t DEFAULT_MOVE_OVERHEAD_MS{ 50 };
+
+// Limits of one search. Zero node count or time means no limit. The search stops at the first limit it reaches. The
+// clock (time left, increments and moves to the time control) is used only if there is no fixed move time.
+struct SearchLimits {
+	int depth{ MAX_PLY - 1 };
+	std::uint64_t nodes{};
+	std::int64_t move_time_ms{};
+	std::int64_t white_time_ms{};
+	std::int64_t black_time_ms{};
+	std::int64_t white_increment_ms{};
+	std::int64_t black_increment_ms{};
+	int moves_to_go{};
+	std::int64_t move_overhead_ms{ DEFAULT_MOVE_OVERHEAD_MS };
+};
+
+// Result of the last completed iteration.
+struct SearchResult {
+	Move best_move{ NO_MOVE };
+	int score{};
+	int depth{};
+	// Node count of all threads and of each of them (the main thread first).
+	std::uint64_t nodes{};
+	std::vector<std::uint64_t> thread_nodes{};
+	double seconds{};
+	std::vector<Move> principal_variation{};
+	// Pawn hash table probes of the main thread and the probes that found their entry. The table stays with the thread
+	// from one search to the next, so they are counted over all searches of the thread.
+	std::uint64_t pawn_table_probes{};
+	std::uint64_t pawn_table_hits{};
+};
+
+// Data a search thread keeps from one search to the next, so its caches stay warm when searches run back to back
+// (games, batch mode, self-play): the pawn hash table and the history of the quiet moves, which orders the moves of
+// the first iterations of the next search too. Every thread that calls search has its own, and so do the
+// helper threads. A caller that runs every search on a new thread (the UCI mode) keeps one and passes it instead.
+struct SearchThreadData {
+	PawnTable pawn_table{};
+	SearchHistory history{};
+};
+
+// This function searches the position with iterative deepening principal variation search and returns the best move.
+// With print_info it prints a UCI "info" line after every iteration (depth, score, nodes, speed and principal
+// variation). With more than one thread it's a Lazy SMP search: the helper threads search the same position and
+// share what they find through the transposition table, and the main thread's result is returned. The table is the
+// global one unless another one is given (self-play gives every engine its own). The main thread uses the given
+// thread data or, without it, the calling thread's own. The helper threads' data is shared by all searches, so a
+// search with more than one thread must not run at the same time as any other search (searches that run in parallel,
+// like in batch mode and self-play, use one thread each).
+SearchResult search(const GameData& game_data, const SearchLimits& limits, bool print_info,
+	TranspositionTable& table = transposition_table, SearchThreadData* thread_data = nullptr);
+
+// This function clears the move ordering history of the thread data (the calling thread's without it) and of the
+// helper threads before a new game, so the search doesn't depend on the games played before.
+void clear_search_history(SearchThreadData* thread_data = nullptr);
+
+// This function sets the number of threads used by the next search (at least 1).
+void set_search_threads(std::size_t thread_count);
+
+// This function returns the number of threads used by the next search.
+std::size_t get_search_threads();
+
+// This function asks the running search to stop. The search then returns the result of the last completed iteration.
+// The request stays until clear_stop_request is called, so a request made just before the search starts isn't lost.
+void stop_search();
+
+// This function clears the stop request before a new search.
+void clear_stop_request();
+
+// This function turns pondering on or off. While pondering, the search doesn't stop because of its time limit.
+void set_pondering(bool ponder);
+
+// This function converts the score into the UCI form ("cp 25" or "mate -3", mate in moves, not plies).
+std::string score_to_string(int score);
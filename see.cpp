@@ -0,0 +1,78 @@
+#include <bit>
+#include <cstddef>
+#include "attacks.h"
+#include "evaluate.h"
+#include "position.h"
+
+// This function returns the value of the piece type in the exchange (the king has none, it's never captured).
+static int exchange_value(int piece_type) {
+	return PIECE_VALUES[static_cast<std::size_t>(piece_type)];
+}
+
+// This function checks if the static exchange evaluation of the move is at least the threshold: the material the side
+// to move wins when both sides keep recapturing on the "move to" square with their least valuable attacker, and
+// either side may stop capturing when it's better off. Sliders behind the capturing pieces join the exchange when the
+// pieces in front of them leave the square's lines (x-rays). Pins aren't taken into account. Nothing is made on the
+// board, the exchange is played on a copy of the occupancy bitboard.
+bool Position::see(Move move, int threshold) const {
+	// Castling can't win or lose material.
+	if (is_castling(move)) return threshold <= 0;
+	int move_from = from_square(move);
+	int move_to = to_square(move);
+	U64 occupied = get_occupied() ^ (1ULL << move_from);
+
+	// Material the move wins right away and the piece then standing on the square.
+	int piece_type = type_of_piece(piece_on(move_from));
+	int gain{};
+	if (move_flags(move) == EN_PASSANT) {
+		gain = exchange_value(PAWN);
+		occupied ^= 1ULL << (move_to + (m_active_color ? ONE_SQUARE_DOWN : ONE_SQUARE_UP));
+	}
+	else if (is_capture(move))
+		gain = exchange_value(type_of_piece(piece_on(move_to)));
+	if (is_promotion(move)) {
+		piece_type = promotion_piece(move);
+		gain += exchange_value(piece_type) - exchange_value(PAWN);
+	}
+
+	// If the move doesn't reach the threshold even when the piece isn't taken back, or reaches it even when the piece
+	// is lost for nothing, the exchange doesn't have to be played. Otherwise swap is what the side to capture next
+	// has to win back.
+	int swap = gain - threshold;
+	if (swap < 0) return false;
+	swap = exchange_value(piece_type) - swap;
+	if (swap <= 0) return true;
+
+	U64 diagonal_sliders = m_all_pieces_bitboards[BISHOP] | m_all_pieces_bitboards[QUEEN];
+	U64 straight_sliders = m_all_pieces_bitboards[ROOK] | m_all_pieces_bitboards[QUEEN];
+	U64 attackers = attackers_to(move_to, occupied);
+	bool white = m_active_color;
+	// True if the move reaches the threshold when the exchange stops now (it turns with every capture).
+	bool result = true;
+	while (true) {
+		white = !white;
+		attackers &= occupied;
+		U64 own_attackers = attackers & get_color_pieces(white);
+		if (!own_attackers) break;
+		result = !result;
+
+		// The least valuable attacker captures.
+		int attacker = PAWN;
+		while (!(own_attackers & m_all_pieces_bitboards[static_cast<std::size_t>(attacker)]))
+			++attacker;
+		// The king can only capture if the opponent has no attackers left.
+		if (attacker == KING)
+			return (attackers & get_color_pieces(!white)) ? !result : result;
+		swap = exchange_value(attacker) - swap;
+		if (swap < static_cast<int>(result)) break;
+		U64 attacker_bits = own_attackers & m_all_pieces_bitboards[static_cast<std::size_t>(attacker)];
+		occupied ^= 1ULL << std::countr_zero(attacker_bits);
+
+		// Sliders behind the attacker (on the line it leaves) now attack the square.
+		if (attacker == PAWN || attacker == BISHOP || attacker == QUEEN)
+			attackers |= bishop_attacks(move_to, occupied) & diagonal_sliders;
+		if (attacker == ROOK || attacker == QUEEN)
+			attackers |= rook_attacks(move_to, occupied) & straight_sliders;
+	}
+	return result;
+}
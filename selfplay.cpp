@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "evaluate.h"
+#include "game_class.h"
+#include "packed_position.h"
+#include "search.h"
+#include "selfplay.h"
+#include "tt.h"
+
+// Default limits of the self-play games.
+static constexpr std::uint64_t DEFAULT_SELF_PLAY_NODES{ 20000 };
+static constexpr std::size_t DEFAULT_SELF_PLAY_HASH_MEGABYTES{ 8 };
+static constexpr int DEFAULT_MAX_GAME_PLIES{ 400 };
+
+// A game is adjudicated as won when one side is ahead by at least this much material (in centipawns) for this many
+// plies in a row.
+static constexpr int DEFAULT_ADJUDICATION_MATERIAL{ 1000 };
+static constexpr int DEFAULT_ADJUDICATION_PLIES{ 8 };
+
+// Longest line of the PGN move text.
+static constexpr std::size_t PGN_LINE_LENGTH{ 80 };
+
+// Number of standard deviations of the 95% confidence interval.
+static constexpr double CONFIDENCE_95{ 1.959964 };
+
+// Standard starting position.
+static constexpr std::string_view START_FEN{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" };
+
+// Settings of one of the two engines.
+struct EngineConfig {
+	std::string description{};
+	SearchLimits limits{};
+	// Time control: time for the whole game and the increment per move (0 - no clock).
+	std::int64_t time_ms{};
+	std::int64_t increment_ms{};
+	std::size_t hash_megabytes{ DEFAULT_SELF_PLAY_HASH_MEGABYTES };
+};
+
+// Engine of a self-play worker: its transposition table and the data its search thread keeps from one move to the
+// next.
+struct EngineState {
+	TranspositionTable table{};
+	SearchThreadData thread_data{};
+};
+
+// Settings of the self-play run.
+struct SelfPlayOptions {
+	std::size_t games{ 100 };
+	std::size_t threads{ 1 };
+	std::array<EngineConfig, 2> engines{};
+	std::vector<std::string> openings{ std::string{ START_FEN } };
+	std::string pgn_file{};
+	std::string packed_file{};
+	int max_plies{ DEFAULT_MAX_GAME_PLIES };
+	int adjudication_material{ DEFAULT_ADJUDICATION_MATERIAL };
+	int adjudication_plies{ DEFAULT_ADJUDICATION_PLIES };
+};
+
+// One played game: the opening, the moves with the scores of the engine that played them and the result.
+struct GameRecord {
+	std::size_t index{};
+	bool engine_a_white{};
+	Position start_position{};
+	std::vector<Move> moves{};
+	std::vector<int> scores{};
+	std::vector<std::string> san_moves{};
+	GameResult result{ RESULT_UNKNOWN };
+	std::string termination{};
+};
+
+// This function parses the engine settings: comma-separated "nodes=<n>", "depth=<plies>", "movetime=<ms>",
+// "tc=<seconds>+<increment seconds>" and "hash=<megabytes>". Throws the description of the error if they are invalid.
+static EngineConfig parse_engine_config(const std::string& text) {
+	EngineConfig config{};
+	config.description = text;
+	config.limits.nodes = DEFAULT_SELF_PLAY_NODES;
+	std::istringstream settings(text);
+	std::string setting{};
+	bool nodes_given{};
+	while (std::getline(settings, setting, ',')) {
+		std::size_t equals = setting.find('=');
+		if (equals == std::string::npos) throw "engine settings have to be name=value.";
+		std::string name = setting.substr(0, equals);
+		std::string value = setting.substr(equals + 1);
+		if (name == "nodes") {
+			config.limits.nodes = std::stoull(value);
+			nodes_given = true;
+		}
+		else if (name == "depth") config.limits.depth = std::clamp(std::stoi(value), 1, MAX_PLY - 1);
+		else if (name == "movetime") config.limits.move_time_ms = std::stoll(value);
+		else if (name == "tc") {
+			std::size_t plus = value.find('+');
+			config.time_ms = static_cast<std::int64_t>(std::stod(value.substr(0, plus)) * 1000);
+			if (plus != std::string::npos)
+				config.increment_ms = static_cast<std::int64_t>(std::stod(value.substr(plus + 1)) * 1000);
+			if (config.time_ms <= 0) throw "the time control has to be positive.";
+		}
+		else if (name == "hash") config.hash_megabytes = std::max<std::size_t>(std::stoul(value), 1);
+		else throw "unknown engine setting.";
+	}
+	// Without an explicit node limit, another limit replaces the default one.
+	if (!nodes_given && (config.limits.depth != MAX_PLY - 1 || config.limits.move_time_ms || config.time_ms))
+		config.limits.nodes = 0;
+	return config;
+}
+
+// This function returns the name of the square (0 - "a1").
+static std::string square_name(int square) {
+	return { static_cast<char>('a' + (square & 7)), static_cast<char>('1' + (square >> 3)) };
+}
+
+// This function converts the legal move into standard algebraic notation (Nf3, exd5, O-O, e8=Q+).
+static std::string move_to_san(const Position& position, Move move) {
+	int move_from = from_square(move);
+	int move_to = to_square(move);
+	int piece_type = type_of_piece(position.piece_on(move_from));
+	std::string san{};
+	if (is_castling(move))
+		san = move_flags(move) == KING_CASTLE ? "O-O" : "O-O-O";
+	else if (piece_type == PAWN) {
+		if (is_capture(move)) san = { static_cast<char>('a' + (move_from & 7)), 'x' };
+		san += square_name(move_to);
+		if (is_promotion(move)) san += std::string{ '=', "NBRQ"[promotion_piece(move) - 1] };
+	}
+	else {
+		san = "NBRQK"[piece_type - 1];
+		// Name the file, the rank or both if another piece of the same type can move to the same square.
+		MoveList move_list;
+		position.generate_legal_moves(move_list);
+		bool ambiguous{};
+		bool same_file{};
+		bool same_rank{};
+		for (Move other_move : move_list) {
+			int other_from = from_square(other_move);
+			if (other_move == move || to_square(other_move) != move_to || other_from == move_from
+				|| type_of_piece(position.piece_on(other_from)) != piece_type)
+				continue;
+			ambiguous = true;
+			same_file = same_file || (other_from & 7) == (move_from & 7);
+			same_rank = same_rank || (other_from >> 3) == (move_from >> 3);
+		}
+		if (ambiguous && (!same_file || same_rank)) san += static_cast<char>('a' + (move_from & 7));
+		if (ambiguous && same_file) san += static_cast<char>('1' + (move_from >> 3));
+		if (is_capture(move)) san += 'x';
+		san += square_name(move_to);
+	}
+	Position next_position = position;
+	UndoInfo undo_info;
+	next_position.make_a_move_bitboards(move, undo_info);
+	if (next_position.is_in_check()) {
+		MoveList replies;
+		next_position.generate_legal_moves(replies);
+		san += replies.empty() ? '#' : '+';
+	}
+	return san;
+}
+
+// This function returns the material balance from White's point of view (in centipawns).
+static int material_balance(const Position& position) {
+	int balance{};
+	for (int piece_type = PAWN; piece_type < KING; ++piece_type) {
+		U64 pieces = position.get_pieces(piece_type);
+		balance += (std::popcount(pieces & position.get_color_pieces(true)) - std::popcount(pieces & position.get_color_pieces(false)))
+			* PIECE_VALUES[static_cast<std::size_t>(piece_type)];
+	}
+	return balance;
+}
+
+// This function returns the Elo difference for the score (0 - 1) of a match.
+static double elo_difference(double score) {
+	score = std::clamp(score, 1e-6, 1 - 1e-6);
+	return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+// Self-play run: the workers take games one at a time, and the finished games are written and counted here.
+class SelfPlayRunner {
+	const SelfPlayOptions& m_options;
+	std::string m_date;
+	std::chrono::steady_clock::time_point m_start{ std::chrono::steady_clock::now() };
+	std::atomic<std::size_t> m_next_game{};
+
+	std::mutex m_results_mutex{};
+	std::ofstream m_pgn_stream{};
+	std::ofstream m_packed_stream{};
+	std::unique_ptr<PackedWriter> m_packed_writer{};
+	// Results from the point of view of engine A.
+	std::size_t m_wins{};
+	std::size_t m_draws{};
+	std::size_t m_losses{};
+	std::size_t m_finished_games{};
+	std::uint64_t m_plies{};
+	std::map<std::string, std::size_t> m_terminations{};
+
+	// This function plays the game with the two engines (engine A first).
+	GameRecord play_game(std::size_t game_index, std::array<std::unique_ptr<EngineState>, 2>& engines) {
+		GameRecord record{};
+		record.index = game_index;
+		// Every opening is played twice, with the colors swapped.
+		record.engine_a_white = game_index % 2 == 0;
+		const std::string& opening = m_options.openings[game_index / 2 % m_options.openings.size()];
+		std::unique_ptr<GameData> game = std::make_unique<GameData>(GameData::create_game_object_from_fen(opening));
+		record.start_position = *game;
+		for (std::unique_ptr<EngineState>& engine : engines) {
+			engine->table.clear();
+			engine->thread_data.history.clear();
+		}
+		std::array<std::int64_t, 2> clocks{ m_options.engines[0].time_ms, m_options.engines[1].time_ms };
+		int adjudication_streak{};
+		while (true) {
+			bool white = game->get_active_color();
+			GameStatus status = game->get_game_status();
+			if (status != GAME_ONGOING) {
+				record.result = status != GAME_CHECKMATE ? RESULT_DRAW : white ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+				record.termination = game_status_to_string(status);
+				break;
+			}
+			int balance = material_balance(*game);
+			adjudication_streak = m_options.adjudication_material && std::abs(balance) >= m_options.adjudication_material
+				? adjudication_streak + 1 : 0;
+			if (m_options.adjudication_plies && adjudication_streak >= m_options.adjudication_plies) {
+				record.result = balance > 0 ? RESULT_WHITE_WINS : RESULT_BLACK_WINS;
+				record.termination = "material adjudication";
+				break;
+			}
+			if (static_cast<int>(record.moves.size()) >= m_options.max_plies) {
+				record.result = RESULT_DRAW;
+				record.termination = "maximum game length";
+				break;
+			}
+			// Engine A is engine 0.
+			std::size_t engine = white == record.engine_a_white ? 0 : 1;
+			const EngineConfig& config = m_options.engines[engine];
+			SearchLimits limits = config.limits;
+			if (config.time_ms) {
+				(white ? limits.white_time_ms : limits.black_time_ms) = clocks[engine];
+				(white ? limits.white_increment_ms : limits.black_increment_ms) = config.increment_ms;
+			}
+			std::chrono::steady_clock::time_point search_start = std::chrono::steady_clock::now();
+			SearchResult result = search(*game, limits, false, engines[engine]->table, &engines[engine]->thread_data);
+			if (config.time_ms) {
+				clocks[engine] -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()
+					- search_start).count();
+				if (clocks[engine] < 0) {
+					record.result = white ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+					record.termination = "time forfeit";
+					break;
+				}
+				clocks[engine] += config.increment_ms;
+			}
+			Move move = result.best_move;
+			record.san_moves.push_back(move_to_san(*game, move));
+			record.moves.push_back(move);
+			record.scores.push_back(result.score);
+			// Keep room on the undo stack for the search. Older positions are dropped from the repetition history then.
+			if (game->undo_capacity_left() <= static_cast<std::size_t>(MAX_PLY))
+				game->reset_undo_stack();
+			game->make_move(move);
+		}
+		return record;
+	}
+
+	// This function writes the game in PGN.
+	void write_pgn(const GameRecord& record) {
+		const std::string& engine_a = m_options.engines[0].description;
+		const std::string& engine_b = m_options.engines[1].description;
+		const char* result = RESULT_STRINGS_PGN[record.result];
+		std::string fen = record.start_position.get_fen();
+		std::ostringstream pgn;
+		pgn << "[Event \"Self-play\"]\n[Site \"?\"]\n[Date \"" << m_date << "\"]\n[Round \"" << record.index + 1 << "\"]\n"
+			<< "[White \"" << (record.engine_a_white ? "A: " + engine_a : "B: " + engine_b) << "\"]\n"
+			<< "[Black \"" << (record.engine_a_white ? "B: " + engine_b : "A: " + engine_a) << "\"]\n"
+			<< "[Result \"" << result << "\"]\n";
+		if (fen != START_FEN) pgn << "[SetUp \"1\"]\n[FEN \"" << fen << "\"]\n";
+		pgn << "[PlyCount \"" << record.moves.size() << "\"]\n\n";
+		std::string line{};
+		int move_number = record.start_position.get_fullmove_number();
+		bool white = record.start_position.get_active_color();
+		std::vector<std::string> tokens{};
+		for (std::size_t i = 0; i < record.san_moves.size(); ++i, white = !white) {
+			if (white) tokens.push_back(std::to_string(move_number) + '.');
+			else if (i == 0) tokens.push_back(std::to_string(move_number) + "...");
+			tokens.push_back(record.san_moves[i]);
+			if (!white) ++move_number;
+		}
+		tokens.push_back('{' + record.termination + '}');
+		tokens.push_back(result);
+		for (const std::string& token : tokens) {
+			if (!line.empty() && line.size() + 1 + token.size() > PGN_LINE_LENGTH) {
+				pgn << line << '\n';
+				line.clear();
+			}
+			line += (line.empty() ? "" : " ") + token;
+		}
+		pgn << line << "\n\n";
+		m_pgn_stream << pgn.str();
+	}
+
+	// This function writes the positions of the game into the packed file, with the scores, the moves played and
+	// the result.
+	void write_packed(const GameRecord& record) {
+		for (std::size_t i = 0; i < record.moves.size(); ++i) {
+			PackedRecordData data{ record.scores[i], record.result, record.moves[i] };
+			if (i == 0) m_packed_writer->write(record.start_position, data);
+			else m_packed_writer->write_move(record.moves[i - 1], data);
+		}
+	}
+
+	// This function prints the results so far: wins, draws and losses of engine A, the Elo difference with its 95%
+	// error bars and the number of games per hour.
+	void print_results() {
+		std::size_t games = m_wins + m_draws + m_losses;
+		double score = (static_cast<double>(m_wins) + static_cast<double>(m_draws) / 2) / static_cast<double>(games);
+		// Standard deviation of the score of one game.
+		double deviation = std::sqrt((static_cast<double>(m_wins) * std::pow(1 - score, 2)
+			+ static_cast<double>(m_draws) * std::pow(0.5 - score, 2) + static_cast<double>(m_losses) * std::pow(score, 2))
+			/ static_cast<double>(games));
+		double margin = CONFIDENCE_95 * deviation / std::sqrt(static_cast<double>(games));
+		double elo = elo_difference(score);
+		double elo_error = (elo_difference(score + margin) - elo_difference(score - margin)) / 2;
+		double hours = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count() / 3600;
+		std::cout << "Games: " << games << "/" << m_options.games << ", A vs B: +" << m_wins << " =" << m_draws << " -"
+			<< m_losses << ", score " << std::fixed << std::setprecision(1) << score * 100 << "%, Elo " << std::showpos
+			<< elo << std::noshowpos << " +/- " << elo_error << ", " << std::setprecision(0)
+			<< static_cast<double>(games) / hours << " games/hour" << '\n';
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	// This function records the finished game: writes it to the output files and counts its result.
+	void finish_game(const GameRecord& record) {
+		std::lock_guard<std::mutex> lock(m_results_mutex);
+		if (m_pgn_stream.is_open()) write_pgn(record);
+		if (m_packed_writer) write_packed(record);
+		bool engine_a_won = record.result == (record.engine_a_white ? RESULT_WHITE_WINS : RESULT_BLACK_WINS);
+		if (record.result == RESULT_DRAW) ++m_draws;
+		else if (engine_a_won) ++m_wins;
+		else ++m_losses;
+		++m_terminations[record.termination];
+		m_plies += record.moves.size();
+		++m_finished_games;
+		// About 20 reports in a run.
+		if (m_finished_games % std::max<std::size_t>(1, m_options.games / 20) == 0 && m_finished_games < m_options.games)
+			print_results();
+	}
+
+	// This function plays games until all of them are taken. Every worker has its own engines: the transposition
+	// tables and search thread data of engine A and engine B.
+	void worker() {
+		std::array<std::unique_ptr<EngineState>, 2> engines{};
+		for (std::size_t engine = 0; engine < engines.size(); ++engine) {
+			engines[engine] = std::make_unique<EngineState>();
+			engines[engine]->table.resize(m_options.engines[engine].hash_megabytes);
+		}
+		while (true) {
+			std::size_t game_index = m_next_game.fetch_add(1);
+			if (game_index >= m_options.games) return;
+			finish_game(play_game(game_index, engines));
+		}
+	}
+
+public:
+	// Game results as written in PGN, by GameResult.
+	static constexpr std::array<const char*, 4> RESULT_STRINGS_PGN{ "*", "1-0", "1/2-1/2", "0-1" };
+
+	// This function opens the output files. Throws the description of the error if it's not possible.
+	explicit SelfPlayRunner(const SelfPlayOptions& options)
+		: m_options{ options }
+	{
+		std::time_t now = std::time(nullptr);
+		std::array<char, 16> date{};
+		std::strftime(date.data(), date.size(), "%Y.%m.%d", std::localtime(&now));
+		m_date = date.data();
+		if (!options.pgn_file.empty()) {
+			m_pgn_stream.open(options.pgn_file);
+			if (!m_pgn_stream) throw "can't create the PGN file.";
+		}
+		if (!options.packed_file.empty()) {
+			m_packed_stream.open(options.packed_file, std::ios::binary);
+			if (!m_packed_stream) throw "can't create the packed file.";
+			m_packed_writer = std::make_unique<PackedWriter>(m_packed_stream, ALL_PACKED_FIELDS);
+		}
+	}
+
+	// This function plays all games and prints the final results.
+	void run() {
+		std::cout << "Engine A: " << m_options.engines[0].description << '\n';
+		std::cout << "Engine B: " << m_options.engines[1].description << '\n';
+		std::cout << "Games: " << m_options.games << ", threads: " << m_options.threads << ", openings: "
+			<< m_options.openings.size() << '\n';
+		std::vector<std::thread> workers{};
+		for (std::size_t i = 0; i < m_options.threads; ++i)
+			workers.emplace_back([this] { worker(); });
+		for (std::thread& worker_thread : workers)
+			worker_thread.join();
+		if (m_packed_writer) m_packed_writer->flush();
+		print_results();
+		std::cout << "Average game length: " << m_plies / std::max<std::size_t>(1, m_finished_games) << " plies" << '\n';
+		for (const auto& [termination, count] : m_terminations)
+			std::cout << "  " << termination << ": " << count << '\n';
+	}
+};
+
+// This function reads the opening positions (one FEN or EPD per line). Throws the description of the error if the file
+// can't be read or has no valid positions.
+static std::vector<std::string> read_openings(const std::string& file_name) {
+	std::ifstream file(file_name);
+	if (!file) throw "can't open the openings file.";
+	std::vector<std::string> openings{};
+	std::string line{};
+	Position position{};
+	while (std::getline(file, line)) {
+		std::string_view fen = fen_of_line(line);
+		if (fen.empty() || line[0] == '#') continue;
+		if (const char* error = position.set_fen(fen)) {
+			std::cerr << "Skipping opening \"" << line << "\": " << error << '\n';
+			continue;
+		}
+		openings.emplace_back(fen);
+	}
+	if (openings.empty()) throw "the openings file has no valid positions.";
+	return openings;
+}
+
+// This function runs the self-play command line mode: "selfplay [options]". Two engine configurations play games
+// against each other on all cores, and the mode reports the results, the Elo difference with its error bars and the
+// number of games per hour. Returns the exit code of the program.
+int selfplay_command(const std::vector<std::string>& arguments) {
+	try {
+		SelfPlayOptions options{};
+		options.threads = std::max(1U, std::thread::hardware_concurrency());
+		std::array<std::string, 2> engine_settings{ "nodes=" + std::to_string(DEFAULT_SELF_PLAY_NODES),
+			"nodes=" + std::to_string(DEFAULT_SELF_PLAY_NODES) };
+		for (std::size_t i = 0; i < arguments.size(); ++i) {
+			const std::string& option = arguments[i];
+			if (i + 1 == arguments.size()) throw "missing option value.";
+			const std::string& value = arguments[++i];
+			if (option == "--games") options.games = std::stoul(value);
+			else if (option == "--threads") options.threads = std::max<std::size_t>(std::stoul(value), 1);
+			else if (option == "--engine-a") engine_settings[0] = value;
+			else if (option == "--engine-b") engine_settings[1] = value;
+			else if (option == "--openings") options.openings = read_openings(value);
+			else if (option == "--pgn") options.pgn_file = value;
+			else if (option == "--packed") options.packed_file = value;
+			else if (option == "--max-plies") options.max_plies = std::max(std::stoi(value), 1);
+			else if (option == "--adjudicate-material") options.adjudication_material = std::max(std::stoi(value), 0);
+			else if (option == "--adjudicate-plies") options.adjudication_plies = std::max(std::stoi(value), 0);
+			else throw "unknown option.";
+		}
+		if (!options.games) throw "the number of games has to be at least 1.";
+		for (std::size_t engine = 0; engine < engine_settings.size(); ++engine)
+			options.engines[engine] = parse_engine_config(engine_settings[engine]);
+		// The games are played in parallel, so every search uses one thread.
+		std::size_t search_threads = get_search_threads();
+		set_search_threads(1);
+		SelfPlayRunner runner{ options };
+		runner.run();
+		set_search_threads(search_threads);
+	}
+	catch (const char* exception) {
+		std::cerr << "Error: " << exception << '\n';
+		std::cerr << "Usage: selfplay [--games n] [--threads n] [--engine-a settings] [--engine-b settings]" << '\n'
+			<< "       [--openings file] [--pgn file] [--packed file] [--max-plies n]" << '\n'
+			<< "       [--adjudicate-material centipawns] [--adjudicate-plies n]" << '\n'
+			<< "Engine settings: comma-separated nodes=<n>, depth=<plies>, movetime=<ms>, tc=<s>+<s>, hash=<MB>"
+			<< '\n';
+		return 1;
+	}
+	catch (const std::exception&) {
+		std::cerr << "Error: option values have to be numbers." << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// This function runs the self-play command line mode: "selfplay [options]". Two engine configurations play games
+// against each other on all cores, and the mode reports the results, the Elo difference with its error bars and the
+// number of games per hour. Returns the exit code of the program.
+int selfplay_command(const std::vector<std::string>& arguments);
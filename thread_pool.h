@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Pool of worker threads with one task queue per worker. A worker takes tasks from the back of its own queue and, when
+// it runs out, steals from the front of the other queues, so workers that got small subtrees help the ones with big
+// ones. All tasks are pushed before run() starts the workers.
+template <typename Task>
+class WorkStealingPool {
+	// Task queue of one worker. Tasks are coarse (whole subtrees), so a mutex per queue is cheap enough.
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<WorkerQueue> m_queues;
+	std::atomic<std::size_t> m_steals{};
+
+public:
+	explicit WorkStealingPool(std::size_t thread_count) : m_queues(thread_count == 0 ? 1 : thread_count) {}
+
+	// This function returns the number of worker threads.
+	std::size_t thread_count() const { return m_queues.size(); }
+
+	// This function returns how many tasks were taken from another worker's queue.
+	std::size_t steals() const { return m_steals.load(); }
+
+	// This function adds a task to the worker's queue.
+	void push(std::size_t worker, Task task) {
+		WorkerQueue& queue = m_queues[worker % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	// This function gets the next task for the worker: from its own queue first, then from the other queues. Returns
+	// false when all queues are empty.
+	bool pop(std::size_t worker, Task& task) {
+		{
+			WorkerQueue& own_queue = m_queues[worker];
+			std::lock_guard<std::mutex> lock(own_queue.mutex);
+			if (!own_queue.tasks.empty()) {
+				task = std::move(own_queue.tasks.back());
+				own_queue.tasks.pop_back();
+				return true;
+			}
+		}
+		for (std::size_t i = 1; i < m_queues.size(); ++i) {
+			WorkerQueue& victim_queue = m_queues[(worker + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(victim_queue.mutex);
+			if (!victim_queue.tasks.empty()) {
+				task = std::move(victim_queue.tasks.front());
+				victim_queue.tasks.pop_front();
+				++m_steals;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// This function starts the workers and waits until all tasks are done. Each worker calls
+	// worker_function(worker_number, pool) once, and the function takes tasks with pop() until it returns false. This
+	// lets every worker set up its own state (for example its own copy of the game) before the first task.
+	template <typename WorkerFunction>
+	void run(WorkerFunction worker_function) {
+		std::vector<std::thread> threads{};
+		for (std::size_t worker = 1; worker < m_queues.size(); ++worker)
+			threads.emplace_back([this, worker, &worker_function] { worker_function(worker, *this); });
+		// The calling thread is worker 0.
+		worker_function(0, *this);
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+};
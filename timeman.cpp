@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <array>
+#include "timeman.h"
+
+// Number of moves the remaining time is divided by when the GUI doesn't send "movestogo".
+static constexpr std::int64_t DEFAULT_MOVES_TO_GO{ 40 };
+
+// The hard deadline is this many times the soft one.
+static constexpr std::int64_t HARD_LIMIT_FACTOR{ 4 };
+
+// Soft deadline factor by the number of iterations in a row with the same best move (the last one for 4 and more).
+static constexpr std::array<double, 5> STABILITY_FACTORS{ 1.6, 1.2, 0.9, 0.7, 0.55 };
+
+// Score drop (in centipawns) at which the soft deadline is doubled.
+static constexpr double FULL_SCORE_DROP{ 100.0 };
+
+// This function sets the deadlines from the limits. Without move time and clock time the search isn't timed.
+TimeManager::TimeManager(const SearchLimits& limits, bool white, std::chrono::steady_clock::time_point start)
+	: m_start{ start }
+{
+	std::int64_t time_left = white ? limits.white_time_ms : limits.black_time_ms;
+	std::int64_t increment = white ? limits.white_increment_ms : limits.black_increment_ms;
+	// A fixed move time is used completely, only the hard deadline stops the search.
+	if (limits.move_time_ms > 0) {
+		m_enabled = true;
+		m_fixed_time = true;
+		m_soft_ms = m_hard_ms = limits.move_time_ms;
+		return;
+	}
+	if (time_left <= 0) return;
+	m_enabled = true;
+	// The move overhead is kept for the communication with the GUI.
+	std::int64_t available = std::max<std::int64_t>(1, time_left - limits.move_overhead_ms);
+	std::int64_t moves_to_go = limits.moves_to_go > 0 ? limits.moves_to_go : DEFAULT_MOVES_TO_GO;
+	// Never more than half of the clock on one move, unless it's the last move before the time control. At least 1 ms
+	// even on an almost empty clock, so the limits of the clamps stay in order.
+	std::int64_t max_use = std::max<std::int64_t>(1, moves_to_go == 1 ? available * 9 / 10 : available / 2);
+	m_soft_ms = std::clamp<std::int64_t>(available / moves_to_go + increment * 3 / 4, 1, max_use);
+	m_hard_ms = std::clamp<std::int64_t>(m_soft_ms * HARD_LIMIT_FACTOR, m_soft_ms, max_use);
+}
+
+// This function decides after an iteration if there is time for the next one. best_move_stability is the number
+// of iterations in a row with the same best move and score_drop is how much the score fell since the previous
+// iteration (in centipawns, negative if it rose).
+bool TimeManager::start_next_iteration(int best_move_stability, int score_drop) const {
+	if (!m_enabled || m_fixed_time) return true;
+	std::int64_t elapsed = elapsed_ms();
+	// The next iteration usually takes longer than all the previous ones together, so one started after half of the
+	// hard limit wouldn't finish.
+	if (elapsed * 2 >= m_hard_ms) return false;
+	double stability_factor = STABILITY_FACTORS[static_cast<std::size_t>(std::clamp(best_move_stability, 0, 4))];
+	double drop_factor = 1.0 + std::clamp(score_drop, 0, static_cast<int>(FULL_SCORE_DROP)) / FULL_SCORE_DROP;
+	return static_cast<double>(elapsed) < static_cast<double>(m_soft_ms) * stability_factor * drop_factor;
+}
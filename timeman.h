@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include "search.h"
+
+// Time manager of one search. It turns the clock (or a fixed move time) into two deadlines: the soft one, after which
+// no new iteration is started, and the hard one, at which a running iteration is stopped. The soft deadline is
+// scaled after every iteration: shorter when the best move keeps being the same, longer when the score drops. A fixed
+// move time has only the hard deadline.
+class TimeManager {
+	std::chrono::steady_clock::time_point m_start{};
+	bool m_enabled{};
+	// With a fixed move time every iteration is started and the search stops only at the hard deadline.
+	bool m_fixed_time{};
+	std::int64_t m_soft_ms{};
+	std::int64_t m_hard_ms{};
+
+public:
+	// This function sets the deadlines from the limits. Without move time and clock time the search isn't timed.
+	TimeManager(const SearchLimits& limits, bool white, std::chrono::steady_clock::time_point start);
+
+	// This function starts counting the time again (after "ponderhit", when the engine's own clock starts).
+	void restart(std::chrono::steady_clock::time_point start) { m_start = start; }
+
+	// This function returns the time since the start in milliseconds.
+	std::int64_t elapsed_ms() const {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+	// This function checks if the search has to stop right away. It reads the clock, so the search only calls it
+	// every few thousand nodes.
+	bool hard_limit_reached() const { return m_enabled && elapsed_ms() >= m_hard_ms; }
+
+	// This function decides after an iteration if there is time for the next one. best_move_stability is the number
+	// of iterations in a row with the same best move and score_drop is how much the score fell since the previous
+	// iteration (in centipawns, negative if it rose).
+	bool start_next_iteration(int best_move_stability, int score_drop) const;
+
+	// These functions return the deadlines in milliseconds.
+	std::int64_t soft_ms() const { return m_soft_ms; }
+	std::int64_t hard_ms() const { return m_hard_ms; }
+};
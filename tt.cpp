@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <string>
+#include "tt.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+TranspositionTable transposition_table{};
+
+// Layout of the data word of an entry: move (bits 0-15), score (16-31), depth (48-55), bound (56-57) and age (58-63).
+// Bits 32-47 are unused.
+static constexpr unsigned SCORE_SHIFT{ 16 };
+static constexpr unsigned DEPTH_SHIFT{ 48 };
+static constexpr unsigned BOUND_SHIFT{ 56 };
+static constexpr unsigned AGE_SHIFT{ 58 };
+
+#if !defined(_WIN32)
+// Huge page size on Linux (transparent huge pages are 2 MB on x86-64).
+static constexpr std::size_t HUGE_PAGE_BYTES{ 2 * 1024 * 1024 };
+#endif
+
+// Entries are read and written by several threads at once, so every access is atomic. Relaxed order is enough, a torn
+// entry is caught by the key check.
+static U64 load_word(U64& word) { return std::atomic_ref<U64>(word).load(std::memory_order_relaxed); }
+static void store_word(U64& word, U64 value) { std::atomic_ref<U64>(word).store(value, std::memory_order_relaxed); }
+
+static Bound bound_of(U64 data) { return static_cast<Bound>((data >> BOUND_SHIFT) & 3); }
+static int depth_of(U64 data) { return static_cast<std::int8_t>(data >> DEPTH_SHIFT); }
+static unsigned age_of(U64 data) { return static_cast<unsigned>(data >> AGE_SHIFT); }
+
+// This function returns the high 64 bits of key * count, which maps the key evenly onto [0, count) without a division
+// and without needing a power of two bucket count.
+static std::size_t multiply_high(U64 key, std::size_t count) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<std::size_t>(__umulh(key, count));
+#elif defined(__SIZEOF_INT128__)
+	return static_cast<std::size_t>((static_cast<unsigned __int128>(key) * count) >> 64);
+#else
+	return static_cast<std::size_t>(key % count);
+#endif
+}
+
+#if defined(_WIN32)
+// This function tries to allocate the memory with large pages. It needs the "Lock pages in memory" privilege, which
+// has to be enabled for the process first. Returns nullptr if it's not possible.
+static void* allocate_large_pages(std::size_t& bytes) {
+	std::size_t large_page_bytes = GetLargePageMinimum();
+	if (!large_page_bytes) return nullptr;
+	HANDLE token{};
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return nullptr;
+	void* memory{};
+	TOKEN_PRIVILEGES privileges{};
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	if (LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS) {
+		std::size_t rounded_bytes = (bytes + large_page_bytes - 1) / large_page_bytes * large_page_bytes;
+		memory = VirtualAlloc(nullptr, rounded_bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory) bytes = rounded_bytes;
+	}
+	CloseHandle(token);
+	return memory;
+}
+#endif
+
+TranspositionTable::~TranspositionTable() {
+	free_memory();
+}
+
+// This function frees the table memory.
+void TranspositionTable::free_memory() {
+	if (!m_buckets) return;
+#if defined(_WIN32)
+	VirtualFree(m_buckets, 0, MEM_RELEASE);
+#else
+	std::free(m_buckets);
+#endif
+	m_buckets = nullptr;
+	m_bucket_count = 0;
+	m_allocated_bytes = 0;
+	m_huge_pages = false;
+}
+
+// This function allocates a table of the size in megabytes (at least 1) and clears it. Huge pages are used if the
+// OS allows it.
+void TranspositionTable::resize(std::size_t megabytes) {
+	free_memory();
+	std::size_t bytes = std::max<std::size_t>(megabytes, 1) << 20;
+#if defined(_WIN32)
+	void* memory = allocate_large_pages(bytes);
+	m_huge_pages = memory != nullptr;
+	if (!memory)
+		memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	// Align to the huge page size so the kernel can back the table with huge pages.
+	bytes = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+	void* memory = std::aligned_alloc(HUGE_PAGE_BYTES, bytes);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	m_huge_pages = memory && madvise(memory, bytes, MADV_HUGEPAGE) == 0;
+#endif
+#endif
+	if (!memory) throw std::bad_alloc{};
+	m_buckets = static_cast<Bucket*>(memory);
+	m_allocated_bytes = bytes;
+	m_bucket_count = (std::max<std::size_t>(megabytes, 1) << 20) / sizeof(Bucket);
+	clear();
+}
+
+// This function clears all entries (for example before a new game).
+void TranspositionTable::clear() {
+	if (m_buckets)
+		std::memset(static_cast<void*>(m_buckets), 0, m_bucket_count * sizeof(Bucket));
+	m_age.store(0, std::memory_order_relaxed);
+}
+
+// This function returns the bucket of the key.
+TranspositionTable::Bucket& TranspositionTable::bucket(U64 key) const {
+	return m_buckets[multiply_high(key, m_bucket_count)];
+}
+
+// This function looks the key up. Returns true and fills data if the key is in the table.
+bool TranspositionTable::probe(U64 key, TTData& data) const {
+	if (!m_buckets) return false;
+	for (Entry& entry : bucket(key).entries) {
+		U64 entry_data = load_word(entry.data);
+		if ((load_word(entry.key_xor_data) ^ entry_data) != key || bound_of(entry_data) == BOUND_NONE)
+			continue;
+		data.move = static_cast<Move>(entry_data);
+		data.score = static_cast<std::int16_t>(entry_data >> SCORE_SHIFT);
+		data.depth = static_cast<std::int8_t>(depth_of(entry_data));
+		data.bound = bound_of(entry_data);
+		return true;
+	}
+	return false;
+}
+
+// This function stores the search result of the position. It replaces the entry of the same position or the
+// least valuable entry of the bucket (the oldest and shallowest one).
+void TranspositionTable::store(U64 key, Move move, int score, int depth, Bound bound) {
+	if (!m_buckets) return;
+	unsigned age = m_age.load(std::memory_order_relaxed);
+	Bucket& key_bucket = bucket(key);
+	Entry* replaced_entry = &key_bucket.entries[0];
+	U64 replaced_data{};
+	bool same_position{};
+	int lowest_value{ INT_MAX };
+	for (Entry& entry : key_bucket.entries) {
+		U64 entry_data = load_word(entry.data);
+		if (bound_of(entry_data) == BOUND_NONE || (load_word(entry.key_xor_data) ^ entry_data) == key) {
+			replaced_entry = &entry;
+			replaced_data = entry_data;
+			same_position = bound_of(entry_data) != BOUND_NONE;
+			break;
+		}
+		// Every search the entry is older costs as much as 8 plies of depth.
+		int relative_age = static_cast<int>((AGE_CYCLE + age - age_of(entry_data)) % AGE_CYCLE);
+		int value = depth_of(entry_data) - 8 * relative_age;
+		if (value < lowest_value) {
+			lowest_value = value;
+			replaced_entry = &entry;
+			replaced_data = entry_data;
+		}
+	}
+	if (same_position) {
+		// Keep the old best move if this search didn't find one.
+		if (move == NO_MOVE) move = static_cast<Move>(replaced_data);
+		// Keep a deeper result of the same search unless the new one is exact.
+		if (bound != BOUND_EXACT && age_of(replaced_data) == age && depth + 4 <= depth_of(replaced_data)) {
+			if (move != static_cast<Move>(replaced_data))
+				store_word(replaced_entry->data, (replaced_data & ~U64{ 0xFFFF }) | move);
+			store_word(replaced_entry->key_xor_data, key ^ load_word(replaced_entry->data));
+			return;
+		}
+	}
+	U64 data = U64{ move }
+		| U64{ static_cast<std::uint16_t>(score) } << SCORE_SHIFT
+		| U64{ static_cast<std::uint8_t>(depth) } << DEPTH_SHIFT
+		| U64{ bound } << BOUND_SHIFT
+		| U64{ age } << AGE_SHIFT;
+	store_word(replaced_entry->data, data);
+	store_word(replaced_entry->key_xor_data, key ^ data);
+}
+
+// This function returns how full the table is in permille (sampled from the first 1000 entries of this search).
+int TranspositionTable::hashfull() const {
+	std::size_t sampled_buckets = std::min<std::size_t>(1000 / BUCKET_ENTRIES, m_bucket_count);
+	if (!sampled_buckets) return 0;
+	std::size_t used_entries{};
+	unsigned age = m_age.load(std::memory_order_relaxed);
+	for (std::size_t i = 0; i < sampled_buckets; ++i) {
+		for (Entry& entry : m_buckets[i].entries) {
+			U64 entry_data = load_word(entry.data);
+			if (bound_of(entry_data) != BOUND_NONE && age_of(entry_data) == age)
+				++used_entries;
+		}
+	}
+	return static_cast<int>(used_entries * 1000 / (sampled_buckets * BUCKET_ENTRIES));
+}
+
+// This function returns the size of the table and whether it's backed by huge pages.
+std::string TranspositionTable::info() const {
+	std::ostringstream info;
+	info << "Transposition table: " << size_megabytes() << " MB, " << m_bucket_count << " buckets, "
+		<< (m_huge_pages ? "huge pages" : "normal pages");
+	return info.str();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "move.h"
+
+typedef uint64_t U64;
+
+// Kind of the stored score: exact, or only a bound because the search failed high (lower bound) or low (upper bound).
+enum Bound : std::uint8_t { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+// Data of one transposition table entry.
+struct TTData {
+	Move move;
+	std::int16_t score;
+	std::int8_t depth;
+	Bound bound;
+};
+
+// Transposition table shared by all search threads. It's a hash table of 64-byte buckets (one cache line) with 4
+// entries each. There are no locks: every entry is two 64-bit words, the data and the key XORed with the data, written
+// and read with relaxed atomic operations. If two threads write the same entry at the same time, the words of the torn
+// entry don't match any key and the entry is just a miss.
+class TranspositionTable {
+	static constexpr std::size_t BUCKET_ENTRIES{ 4 };
+
+	struct Entry {
+		U64 key_xor_data;
+		U64 data;
+	};
+
+	struct alignas(64) Bucket {
+		std::array<Entry, BUCKET_ENTRIES> entries;
+	};
+
+	// Age of the current search (6 bits). Entries from older searches are replaced first.
+	static constexpr unsigned AGE_BITS{ 6 };
+	static constexpr unsigned AGE_CYCLE{ 1u << AGE_BITS };
+
+	Bucket* m_buckets{};
+	std::size_t m_bucket_count{};
+	std::size_t m_allocated_bytes{};
+	bool m_huge_pages{};
+	// Atomic because independent searches (batch mode) may start at the same time.
+	std::atomic<std::uint8_t> m_age{};
+
+	// This function returns the bucket of the key.
+	Bucket& bucket(U64 key) const;
+
+	// This function frees the table memory.
+	void free_memory();
+
+public:
+	TranspositionTable() = default;
+	TranspositionTable(const TranspositionTable&) = delete;
+	TranspositionTable& operator=(const TranspositionTable&) = delete;
+	~TranspositionTable();
+
+	// This function allocates a table of the size in megabytes (at least 1) and clears it. Huge pages are used if the
+	// OS allows it.
+	void resize(std::size_t megabytes);
+
+	// This function clears all entries (for example before a new game).
+	void clear();
+
+	// This function starts a new search: the entries stored from now on are newer than all the existing ones.
+	void new_search() {
+		m_age.store(static_cast<std::uint8_t>((m_age.load(std::memory_order_relaxed) + 1) % AGE_CYCLE),
+			std::memory_order_relaxed);
+	}
+
+	// This function looks the key up. Returns true and fills data if the key is in the table.
+	bool probe(U64 key, TTData& data) const;
+
+	// This function stores the search result of the position. It replaces the entry of the same position or the
+	// least valuable entry of the bucket (the oldest and shallowest one).
+	void store(U64 key, Move move, int score, int depth, Bound bound);
+
+	// This function returns how full the table is in permille (sampled from the first 1000 entries of this search).
+	int hashfull() const;
+
+	// This function returns the size of the table in megabytes.
+	std::size_t size_megabytes() const { return m_bucket_count * sizeof(Bucket) >> 20; }
+
+	// This function returns the size of the table and whether it's backed by huge pages.
+	std::string info() const;
+};
+
+// Transposition table shared by all searches.
+extern TranspositionTable transposition_table;
+
+// Default size of the transposition table in megabytes.
+constexpr std::size_t DEFAULT_HASH_MEGABYTES{ 16 };
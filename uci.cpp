@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "game_class.h"
+#include "nnue.h"
+#include "search.h"
+#include "tt.h"
+#include "uci.h"
+
+// Name reported to the GUI.
+static const std::string ENGINE_NAME{ "chess_engine" };
+
+// Largest transposition table the "Hash" option allows (in megabytes).
+static constexpr std::size_t MAX_HASH_MEGABYTES{ 65536 };
+
+// Largest time the "Move Overhead" option allows (in milliseconds).
+static constexpr std::int64_t MAX_MOVE_OVERHEAD_MS{ 5000 };
+
+// This function writes the line to the standard output in one write, so lines of different threads don't get mixed.
+static void send(const std::string& line) {
+	std::cout << line + '\n' << std::flush;
+}
+
+// UCI mode state: the current position, the search thread and the queue of commands read by the input thread.
+class UciEngine {
+	GameData m_game_data{ GameData::create_game_object_start_pos() };
+	std::thread m_search_thread{};
+	// Every search runs on a new thread, so the data its thread keeps from one search to the next is kept here.
+	std::unique_ptr<SearchThreadData> m_search_data{ std::make_unique<SearchThreadData>() };
+	std::int64_t m_move_overhead_ms{ DEFAULT_MOVE_OVERHEAD_MS };
+
+	std::mutex m_queue_mutex{};
+	std::condition_variable m_queue_condition{};
+	std::deque<std::string> m_commands{};
+
+	// Set by the input thread in the order the commands arrive, so they can't be missed by a search that's just
+	// starting. The search thread checks them before it sends "bestmove" after "go infinite" or "go ponder".
+	std::atomic<bool> m_stop_received{};
+	std::atomic<bool> m_ponder_active{};
+	// Set by the input thread when it reads "go" and cleared when the search has sent its best move. The input thread
+	// waits for it before the next "go", so "stop" for one search can't be cleared by the next one. A "go" during a
+	// search stops it first, otherwise a "go infinite" or "go ponder" search would never end: only this thread can
+	// read the "stop".
+	std::atomic<bool> m_searching{};
+
+	// This function reads the input. "go", "stop", "ponderhit" and "quit" take effect here, before they are queued, so a
+	// running search is stopped without waiting for the command thread.
+	void input_loop() {
+		std::string line{};
+		while (true) {
+			if (!std::getline(std::cin, line)) line = "quit";
+			std::istringstream command_stream(line);
+			std::string command{};
+			command_stream >> command;
+			if (command == "go") {
+				bool ponder = line.find(" ponder") != std::string::npos;
+				if (m_searching) {
+					m_stop_received = true;
+					stop_search();
+				}
+				m_searching.wait(true);
+				m_searching = true;
+				m_stop_received = false;
+				m_ponder_active = ponder;
+				clear_stop_request();
+				set_pondering(ponder);
+			}
+			else if (command == "stop" || command == "quit") {
+				m_stop_received = true;
+				stop_search();
+			}
+			else if (command == "ponderhit") {
+				m_ponder_active = false;
+				set_pondering(false);
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_queue_mutex);
+				m_commands.push_back(line);
+			}
+			m_queue_condition.notify_one();
+			if (command == "quit") return;
+		}
+	}
+
+	// This function returns the next command, waiting for one if the queue is empty.
+	std::string next_command() {
+		std::unique_lock<std::mutex> lock(m_queue_mutex);
+		m_queue_condition.wait(lock, [this] { return !m_commands.empty(); });
+		std::string command = m_commands.front();
+		m_commands.pop_front();
+		return command;
+	}
+
+	// This function waits until the running search (if any) has sent its best move.
+	void wait_for_search() {
+		if (m_search_thread.joinable())
+			m_search_thread.join();
+	}
+
+	// This function answers "uci": the engine name and the options.
+	void send_id() {
+		send("id name " + ENGINE_NAME);
+		send("id author " + ENGINE_NAME + " developers");
+		send("option name Hash type spin default " + std::to_string(DEFAULT_HASH_MEGABYTES) + " min 1 max "
+			+ std::to_string(MAX_HASH_MEGABYTES));
+		send("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_SEARCH_THREADS));
+		send("option name Move Overhead type spin default " + std::to_string(DEFAULT_MOVE_OVERHEAD_MS) + " min 0 max "
+			+ std::to_string(MAX_MOVE_OVERHEAD_MS));
+		send("option name Ponder type check default false");
+		send("option name Clear Hash type button");
+		send(std::string{ "option name EvalFile type string default " } + DEFAULT_NETWORK_FILE);
+		send("uciok");
+	}
+
+	// This function finds the legal move written in UCI form (e2e4, e7e8q). Returns NO_MOVE if there is none.
+	Move find_uci_move(const std::string& move_string) const {
+		MoveList move_list;
+		m_game_data.generate_legal_moves(move_list);
+		for (Move move : move_list)
+			if (move_to_string(move) == move_string)
+				return move;
+		return NO_MOVE;
+	}
+
+	// This function handles "position [startpos | fen <fen>] [moves <move> ...]". The moves are made one by one on the
+	// new position.
+	void set_position(std::istringstream& arguments) {
+		std::string token{};
+		arguments >> token;
+		if (token == "startpos") {
+			m_game_data = GameData::create_game_object_start_pos();
+			arguments >> token;
+		}
+		else if (token == "fen") {
+			std::string fen{};
+			while (arguments >> token && token != "moves")
+				fen += token + ' ';
+			try {
+				m_game_data = GameData::create_game_object_from_fen(fen);
+			}
+			catch (const char* exception) {
+				send(std::string{ "info string Error: invalid FEN: " } + exception);
+				return;
+			}
+		}
+		else {
+			send("info string Error: position has to be startpos or fen.");
+			return;
+		}
+		if (token != "moves") return;
+		while (arguments >> token) {
+			Move move = find_uci_move(token);
+			if (move == NO_MOVE) {
+				send("info string Error: illegal move " + token + '.');
+				return;
+			}
+			// Keep room on the undo stack for the search. Only very long games get here.
+			if (m_game_data.undo_capacity_left() <= static_cast<std::size_t>(MAX_PLY))
+				m_game_data.reset_undo_stack();
+			m_game_data.make_move(move);
+		}
+	}
+
+	// This function handles "go" with depth, nodes, movetime, wtime, btime, winc, binc, movestogo, infinite and ponder,
+	// and starts the search thread. The time manager of the search decides how much of the clock time to use.
+	void go(std::istringstream& arguments) {
+		SearchLimits limits{};
+		limits.move_overhead_ms = m_move_overhead_ms;
+		bool infinite{};
+		std::string token{};
+		while (arguments >> token) {
+			if (token == "depth") arguments >> limits.depth;
+			else if (token == "nodes") arguments >> limits.nodes;
+			else if (token == "movetime") arguments >> limits.move_time_ms;
+			else if (token == "wtime") arguments >> limits.white_time_ms;
+			else if (token == "btime") arguments >> limits.black_time_ms;
+			else if (token == "winc") arguments >> limits.white_increment_ms;
+			else if (token == "binc") arguments >> limits.black_increment_ms;
+			else if (token == "movestogo") arguments >> limits.moves_to_go;
+			// "ponder" was handled by the input thread.
+			else if (token == "infinite") infinite = true;
+		}
+		limits.depth = std::clamp(limits.depth, 1, MAX_PLY - 1);
+		if (infinite) {
+			limits = SearchLimits{};
+			limits.depth = MAX_PLY - 1;
+		}
+		m_search_thread = std::thread([this, limits, infinite] {
+			SearchResult result = search(m_game_data, limits, true, transposition_table, m_search_data.get());
+			// After "go infinite" or "go ponder" the best move may only be sent after "stop" or "ponderhit".
+			while (!m_stop_received && (infinite || m_ponder_active))
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			std::string best_move = result.best_move == NO_MOVE ? "0000" : move_to_string(result.best_move);
+			if (result.principal_variation.size() > 1)
+				send("bestmove " + best_move + " ponder " + move_to_string(result.principal_variation[1]));
+			else
+				send("bestmove " + best_move);
+			m_searching = false;
+			m_searching.notify_all();
+		});
+	}
+
+	// This function handles "setoption name <name> [value <value>]".
+	void set_option(std::istringstream& arguments) {
+		std::string token{};
+		std::string name{};
+		std::string value{};
+		arguments >> token;
+		while (arguments >> token && token != "value")
+			name += (name.empty() ? "" : " ") + token;
+		while (arguments >> token)
+			value += (value.empty() ? "" : " ") + token;
+		try {
+			if (name == "Hash")
+				transposition_table.resize(std::clamp<std::size_t>(std::stoul(value), 1, MAX_HASH_MEGABYTES));
+			else if (name == "Threads")
+				set_search_threads(std::stoul(value));
+			else if (name == "Move Overhead")
+				m_move_overhead_ms = std::clamp<std::int64_t>(std::stoll(value), 0, MAX_MOVE_OVERHEAD_MS);
+			else if (name == "Clear Hash")
+				transposition_table.clear();
+			// An empty value switches to the classical evaluation. If the file can't be loaded, the current evaluation
+			// stays.
+			else if (name == "EvalFile") {
+				if (value.empty() || value == "<empty>")
+					unload_network();
+				else if (const char* error = load_network(value))
+					throw error;
+				send("info string " + network_info());
+			}
+			else if (name != "Ponder")
+				throw "unknown option.";
+		}
+		catch (const char* exception) {
+			send("info string Error: " + name + ": " + exception);
+		}
+		catch (const std::exception&) {
+			send("info string Error: " + name + ": value has to be a number.");
+		}
+	}
+
+public:
+	// This function processes the commands until "quit".
+	int run(bool handshake_received) {
+		if (handshake_received) send_id();
+		std::thread input_thread([this] { input_loop(); });
+		while (true) {
+			std::string line = next_command();
+			std::istringstream arguments(line);
+			std::string command{};
+			arguments >> command;
+			if (command == "quit") break;
+			if (command == "uci") send_id();
+			else if (command == "isready") send("readyok");
+			else if (command == "ucinewgame") {
+				wait_for_search();
+				transposition_table.clear();
+				clear_search_history(m_search_data.get());
+			}
+			else if (command == "position") {
+				wait_for_search();
+				set_position(arguments);
+			}
+			else if (command == "go") {
+				wait_for_search();
+				go(arguments);
+			}
+			else if (command == "stop") wait_for_search();
+			else if (command == "setoption") {
+				wait_for_search();
+				set_option(arguments);
+			}
+			// "ponderhit" was handled by the input thread.
+			else if (!command.empty() && command != "ponderhit")
+				send("info string Unknown command: " + command);
+		}
+		wait_for_search();
+		input_thread.join();
+		return 0;
+	}
+};
+
+// This function runs the UCI (Universal Chess Interface) mode until "quit" or the end of the input. Commands are read
+// on their own thread and searches run on another one, so "stop" reaches a running search right away. If the "uci"
+// command was already read (by the interactive prompt), handshake_received makes it answer it first. Returns the exit
+// code of the program.
+int uci_loop(bool handshake_received) {
+	UciEngine engine{};
+	return engine.run(handshake_received);
+}
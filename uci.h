@@ -0,0 +1,7 @@
+#pragma once
+
+// This function runs the UCI (Universal Chess Interface) mode until "quit" or the end of the input. Commands are read
+// on their own thread and searches run on another one, so "stop" reaches a running search right away. If the "uci"
+// command was already read (by the interactive prompt), handshake_received makes it answer it first. Returns the exit
+// code of the program.
+int uci_loop(bool handshake_received);
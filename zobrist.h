@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+typedef uint64_t U64;
+
+// Random keys for Zobrist hashing. The key of a position is the XOR of the keys of all its parts, so making a move only
+// has to XOR out the parts that changed and XOR in the new ones.
+struct ZobristKeys {
+	// Indexed by the piece code (see make_piece in position.h) and the square. Codes that aren't pieces have zero keys.
+	std::array<std::array<U64, 64>, 16> piece_square;
+	// Indexed by the 4 castling rights bits.
+	std::array<U64, 16> castling;
+	// Indexed by the file of the en passant target square.
+	std::array<U64, 8> en_passant_file;
+	// XORed in when black is to move.
+	U64 black_to_move;
+};
+
+// SplitMix64 pseudo-random generator. The seed is fixed, so the keys (and every stored hash) are the same in every
+// build and on every platform.
+constexpr U64 zobrist_random(U64& state) {
+	U64 z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Zobrist keys, built at compile time.
+inline constexpr ZobristKeys ZOBRIST = [] {
+	ZobristKeys keys{};
+	U64 state{ 0x2545F4914F6CDD1DULL };
+	constexpr std::array<std::size_t, 12> PIECE_CODES{ 0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13 };
+	for (std::size_t piece : PIECE_CODES)
+		for (U64& key : keys.piece_square[piece])
+			key = zobrist_random(state);
+	for (U64& key : keys.castling)
+		key = zobrist_random(state);
+	// No castling rights hash to zero, like no en passant square.
+	keys.castling[0] = 0;
+	for (U64& key : keys.en_passant_file)
+		key = zobrist_random(state);
+	keys.black_to_move = zobrist_random(state);
+	return keys;
+}();